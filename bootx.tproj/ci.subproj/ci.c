@@ -31,8 +31,57 @@
 
 static ClientInterfacePtr gCIPtr;
 
+#if kCIProfile
+// The calls for each service are counted and timed with the timebase,
+// and the bytes returned by read are added up.  SaveCIProfile puts
+// the table in /chosen as BootXCIProfile, an array of:
+//   char          service[32];   NUL terminated
+//   unsigned long count;
+//   unsigned long ticksHigh;     total timebase ticks, high word
+//   unsigned long ticksLow;      and low word
+//   unsigned long maxTicks;      longest single call
+//   unsigned long bytes;         read only
+
+#define kCIProfileMaxServices (32)
+#define kCIProfileNameLength  (32)
+
+struct CIProfile {
+  char               *service;
+  long               isRead;
+  unsigned long      count;
+  unsigned long      maxTicks;
+  unsigned long      bytes;
+  unsigned long long ticks;
+};
+typedef struct CIProfile CIProfile, *CIProfilePtr;
+
+struct CIProfileProp {
+  char          service[kCIProfileNameLength];
+  unsigned long count;
+  unsigned long ticksHigh;
+  unsigned long ticksLow;
+  unsigned long maxTicks;
+  unsigned long bytes;
+};
+typedef struct CIProfileProp CIProfileProp, *CIProfilePropPtr;
+
+static CIProfilePtr FindCIProfile(char *service);
+
+static CIProfile gCIProfile[kCIProfileMaxServices];
+static long      gCIProfileCount;
+static long      gCIProfileTimebase;
+#endif
+
 long InitCI(ClientInterfacePtr ciPtr)
 {
+#if kCIProfile
+  unsigned long pvr;
+  
+  // The 601 has no timebase; only count its calls.
+  __asm__ volatile("mfpvr %0" : "=r" (pvr));
+  gCIProfileTimebase = ((pvr >> 16) != 1);
+#endif
+  
   gCIPtr = ciPtr;
   
   return 0;
@@ -41,11 +90,104 @@ long InitCI(ClientInterfacePtr ciPtr)
 long CallCI(CIArgs *ciArgsPtr)
 {
   long ret;
+#if kCIProfile
+  unsigned long start = 0, ticks = 0;
+  CIProfilePtr  profile;
+  
+  if (gCIProfileTimebase) __asm__ volatile("mftb %0" : "=r" (start));
+#endif
   
   ret = (*gCIPtr)(ciArgsPtr);
+  
+#if kCIProfile
+  if (gCIProfileTimebase) {
+    __asm__ volatile("mftb %0" : "=r" (ticks));
+    ticks -= start;
+  }
+  
+  profile = FindCIProfile(ciArgsPtr->service);
+  if (profile != 0) {
+    profile->count++;
+    profile->ticks += ticks;
+    if (ticks > profile->maxTicks) profile->maxTicks = ticks;
+    if (profile->isRead && (ret == 0) && (ciArgsPtr->args.read.actual > 0))
+      profile->bytes += ciArgsPtr->args.read.actual;
+  }
+#endif
+  
   return ret;
 }
 
+#if kCIProfile
+// Print the profile and save it in /chosen.
+void SaveCIProfile(void)
+{
+  CIProfileProp      props[kCIProfileMaxServices];
+  CIProfilePtr       profile;
+  CICell             cpuPH;
+  unsigned long      tbFrequency = 0;
+  unsigned long long usecs;
+  long               cnt, count;
+  
+  // Take a copy first, since SetProp is a call too.
+  count = gCIProfileCount;
+  for (cnt = 0; cnt < count; cnt++) {
+    profile = &gCIProfile[cnt];
+    bzero(props[cnt].service, kCIProfileNameLength);
+    strncpy(props[cnt].service, profile->service, kCIProfileNameLength - 1);
+    props[cnt].count = profile->count;
+    props[cnt].ticksHigh = profile->ticks >> 32;
+    props[cnt].ticksLow = profile->ticks;
+    props[cnt].maxTicks = profile->maxTicks;
+    props[cnt].bytes = profile->bytes;
+  }
+  
+  cpuPH = SearchForNode(0, 1, "device_type", "cpu");
+  if (cpuPH != 0)
+    GetProp(cpuPH, "timebase-frequency", (char *)&tbFrequency, 4);
+  
+  printf("Client interface calls:\n");
+  for (cnt = 0; cnt < count; cnt++) {
+    profile = &gCIProfile[cnt];
+    usecs = 0;
+    if (tbFrequency != 0) usecs = profile->ticks * 1000000 / tbFrequency;
+    printf("  %20s %8d calls %10d us", profile->service,
+	   profile->count, (unsigned long)usecs);
+    if (profile->isRead) printf(" %10d bytes", profile->bytes);
+    printf("\n");
+  }
+  
+  SetProp(gChosenPH, "BootXCIProfile", (char *)props,
+	  count * sizeof(CIProfileProp));
+}
+
+static CIProfilePtr FindCIProfile(char *service)
+{
+  CIProfilePtr profile;
+  long         cnt;
+  
+  // The service names are almost always the same strings each time.
+  for (cnt = 0; cnt < gCIProfileCount; cnt++) {
+    if (gCIProfile[cnt].service == service) return &gCIProfile[cnt];
+  }
+  for (cnt = 0; cnt < gCIProfileCount; cnt++) {
+    if (!strcmp(gCIProfile[cnt].service, service)) return &gCIProfile[cnt];
+  }
+  
+  if (gCIProfileCount == kCIProfileMaxServices) return 0;
+  
+  profile = &gCIProfile[gCIProfileCount++];
+  profile->service = service;
+  profile->isRead = !strcmp(service, "read");
+  
+  return profile;
+}
+#else
+void SaveCIProfile(void)
+{
+}
+#endif
+
 
 // Device Tree
 
@@ -560,6 +702,8 @@ void Enter(void)
 {
   CIArgs ciArgs;
   
+  FlushOutput();
+  
   ciArgs.service = "enter";
   ciArgs.nArgs = 0;
   ciArgs.nReturns = 0;
@@ -572,6 +716,8 @@ void Exit(void)
 {
   CIArgs ciArgs;
   
+  FlushOutput();
+  
   ciArgs.service = "exit";
   ciArgs.nArgs = 0;
   ciArgs.nReturns = 0;
@@ -586,6 +732,8 @@ void Quiesce(void)
 {
   CIArgs ciArgs;
   
+  FlushOutput();
+  
   ciArgs.service = "quiesce";
   ciArgs.nArgs = 0;
   ciArgs.nReturns = 0;
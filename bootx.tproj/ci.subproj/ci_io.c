@@ -31,10 +31,23 @@
 #include <sl_words.h>
 #include <libclite.h>
 
+// Output is collected a line at a time and handed to sl_words with its
+// newline in one call, rather than making a call into Open Firmware
+// per character.
+#define kOutputBufferSize (256)
+
+static char gOutputBuffer[kOutputBufferSize];
+static long gOutputCount;
+
 int putchar(int ch)
 {
-  if ((ch == '\r') || (ch == '\n')) CallMethod(0, 0, SLWordsIH, "slw_cr");
-  else CallMethod(1, 0, SLWordsIH, "slw_emit", ch);
+  if ((ch == '\r') || (ch == '\n')) {
+    CallMethod(2, 0, SLWordsIH, "slw_type_cr", gOutputBuffer, gOutputCount);
+    gOutputCount = 0;
+  } else {
+    if (gOutputCount == kOutputBufferSize) FlushOutput();
+    gOutputBuffer[gOutputCount++] = ch;
+  }
   
   return ch;
 }
@@ -48,3 +61,13 @@ int puts(const char *str)
   
   return 0;
 }
+
+// Write out any partial line.  This must be done before anything else
+// can write to the console or the output level changes.
+void FlushOutput(void)
+{
+  if (gOutputCount == 0) return;
+  
+  CallMethod(2, 0, SLWordsIH, "slw_type", gOutputBuffer, gOutputCount);
+  gOutputCount = 0;
+}
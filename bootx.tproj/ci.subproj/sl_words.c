@@ -71,6 +71,12 @@ long InitSLWords(void)
      // slw_cr ( -- )
      " : slw_cr   2 outputLevel <= if cr then ;"
      
+     // slw_type ( addr len -- )
+     " : slw_type 2 outputLevel <= if type else 2drop then ;"
+     
+     // slw_type_cr ( addr len -- )
+     " : slw_type_cr 2 outputLevel <= if type cr else 2drop then ;"
+     
      // Static init stuff for keyboard
      " 0 value keyboardIH"
      " 20 buffer: keyMap"
@@ -202,6 +208,7 @@ void InitDebugWords(void)
 
 void SetOutputLevel(long level)
 {
+  FlushOutput();
   CallMethod(1, 0, SLWordsIH, "slw_set_output_level", level);
 }
 
@@ -224,23 +231,104 @@ void UpdateKeyMap(void)
 }
 
 
+// The wait cursor is run from here rather than by slw_spin, so that
+// a Read only calls into Open Firmware when a frame is due.  The
+// timebase says when that is, and the frame is copied straight to the
+// frame buffer when its address is known.  slw_spin is still set up
+// for Open Firmware's own spin, and does the work on a 601, which has
+// no timebase.
+
+static CICell        gSpinScreenIH;
+static char          *gSpinAddr;
+static long          gSpinX, gSpinY, gSpinW, gSpinH;
+static long          gSpinFrames, gSpinPixelSize, gSpinStage;
+static unsigned long gSpinTime, gSpinDelay;
+static char          *gSpinFrameBuffer;
+static long          gSpinRowBytes;
+
 void SpinInit(CICell screenIH, char *cursorAddr,
 	      long cursorX, long cursorY,
 	      long cursorW, long cursorH,
 	      long frames,  long fps,
 	      long pixelSize, long spare)
 {
+  CICell        cpuPH;
+  unsigned long pvr, tbFrequency = 0;
+  
   CallMethod(6, 0, SLWordsIH, "slw_spin_init",
 	     screenIH, (long)cursorAddr,
 	     cursorX | (frames << 16),
 	     cursorY | (fps << 16),
 	     cursorW | (pixelSize << 16),
 	     cursorH | (spare << 16));
+  
+  gSpinScreenIH = screenIH;
+  gSpinAddr = (frames > 0) ? cursorAddr : 0;
+  gSpinX = cursorX;
+  gSpinY = cursorY;
+  gSpinW = cursorW;
+  gSpinH = cursorH;
+  gSpinFrames = frames;
+  gSpinPixelSize = pixelSize;
+  gSpinStage = 0;
+  gSpinFrameBuffer = 0;
+  gSpinDelay = 0;
+  
+  if ((screenIH == 0) || (gSpinAddr == 0) || (fps <= 0)) return;
+  
+  __asm__ volatile("mfpvr %0" : "=r" (pvr));
+  if ((pvr >> 16) == 1) return;
+  
+  cpuPH = SearchForNode(0, 1, "device_type", "cpu");
+  if (cpuPH == 0) return;
+  
+  GetProp(cpuPH, "timebase-frequency", (char *)&tbFrequency, 4);
+  
+  gSpinDelay = tbFrequency / fps;
+  __asm__ volatile("mftb %0" : "=r" (gSpinTime));
+}
+
+void SpinInitFrameBuffer(char *baseAddr, long rowBytes)
+{
+  gSpinFrameBuffer = baseAddr;
+  gSpinRowBytes = rowBytes;
 }
 
 void Spin(void)
 {
-  CallMethod(0, 0, SLWordsIH, "slw_spin");
+  unsigned long time;
+  char          *frame, *dest;
+  long          row, size;
+  
+  if ((gSpinScreenIH == 0) || (gSpinAddr == 0)) return;
+  
+  if (gSpinDelay == 0) {
+    CallMethod(0, 0, SLWordsIH, "slw_spin");
+    return;
+  }
+  
+  __asm__ volatile("mftb %0" : "=r" (time));
+  if ((time - gSpinTime) < gSpinDelay) return;
+  gSpinTime = time;
+  
+  UpdateKeyMap();
+  
+  gSpinStage = (gSpinStage + 1) % gSpinFrames;
+  size = gSpinW * gSpinPixelSize;
+  frame = gSpinAddr + gSpinStage * gSpinH * size;
+  
+  if (gSpinFrameBuffer == 0) {
+    CallMethod(5, 0, gSpinScreenIH, "draw-rectangle", (long)frame,
+	       gSpinX, gSpinY, gSpinW, gSpinH);
+    return;
+  }
+  
+  dest = gSpinFrameBuffer + gSpinY * gSpinRowBytes + gSpinX * gSpinPixelSize;
+  for (row = 0; row < gSpinH; row++) {
+    bcopy(frame, dest, size);
+    frame += size;
+    dest += gSpinRowBytes;
+  }
 }
 
 
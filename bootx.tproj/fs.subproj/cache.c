@@ -20,7 +20,7 @@
  * @APPLE_LICENSE_HEADER_END@
  */
 /*
- *  cache.c - A simple cache for file systems meta-data.
+ *  cache.c - A hashed LRU cache for file systems meta-data.
  *
  *  Copyright (c) 2000 - 2003 Apple Computer, Inc.
  *
@@ -31,110 +31,465 @@
 #include <fs.h>
 
 struct CacheEntry {
-  CICell    ih;
-  long      time;
+  CICell    ih;		// zero when the entry is empty
   long long offset;
+  long      hashNext;	// next entry in the same hash bucket
+  long      lruPrev;	// toward the most recently used entry
+  long      lruNext;	// toward the least recently used entry
+  long      readAhead;	// read ahead and not yet asked for
 };
 typedef struct CacheEntry CacheEntry;
 
+// Each device that has been through CacheInit gets its own block size
+// and its own share of the cache, so switching partitions does not
+// throw away the blocks of the others.
+struct CacheDevice {
+  CICell    ih;		// zero when the slot is free
+  long      blockSize;
+  long      numSlabs;
+  long      lruHead;
+  long      lruTail;
+  long      lastInit;
+  long long streamNext;	// block after the last one read from disk
+  long      readAhead;	// blocks to read on the next sequential miss
+};
+typedef struct CacheDevice CacheDevice, *CacheDevicePtr;
+
 #define kCacheSize            (kFSCacheSize)
 #define kCacheMinBlockSize    (0x200)
 #define kCacheMaxBlockSize    (0x4000)
 #define kCacheMaxEntries      (kCacheSize / kCacheMinBlockSize)
+#define kCacheHashBits        (13)
+#define kCacheHashSize        (1 << kCacheHashBits)
+#define kCacheNoEntry         (-1)
+
+// The cache is handed out to devices in slabs.  Entry numbers are
+// reserved per slab for the smallest block size.
+#define kCacheMaxDevices      (8)
+#define kCacheNumSlabs        (16)
+#define kCacheSlabSize        (kCacheSize / kCacheNumSlabs)
+#define kCacheSlabEntries     (kCacheSlabSize / kCacheMinBlockSize)
+
+// Sequential misses read ahead in one Read, doubling the window
+// each time the stream continues.
+#define kCacheMaxReadAhead    (0x10000)
+
+static CacheDevicePtr CacheFindDevice(CICell ih);
+static CacheDevicePtr CacheNewDevice(CICell ih);
+static void CacheReleaseDevice(CacheDevicePtr device);
+static void CacheAddSlab(CacheDevicePtr device, long slab);
+static void CacheRemoveSlab(CacheDevicePtr device, long slab);
+static long CacheReadAheadBlocks(CacheDevicePtr device, long long offset);
+static long CacheReadAhead(CacheDevicePtr device, char *buffer,
+			   long long offset, long numBlocks);
+static void CacheInsert(CacheDevicePtr device, long long offset,
+			char *buffer, long readAhead);
+static char *CacheEntryBuffer(CacheDevicePtr device, long entryNum);
+static long CacheHash(CICell ih, long long offset);
+static long CacheLookup(CICell ih, long long offset);
+static void CacheLRURemove(CacheDevicePtr device, long entryNum);
+static void CacheLRUInsertHead(CacheDevicePtr device, long entryNum);
+static void CacheLRUInsertTail(CacheDevicePtr device, long entryNum);
+static void CacheHashRemove(long entryNum);
 
-static CICell     gCacheIH;
-static long       gCacheBlockSize;
-static long       gCacheNumEntries;
-static long       gCacheTime;
-static CacheEntry gCacheEntries[kCacheMaxEntries];
-static char       *gCacheBuffer = (char *)kFSCacheAddr;
+static long           gCacheInitialized;
+static long           gCacheInitTime;
+static CacheDevicePtr gCacheLastDevice;
+static CacheDevice    gCacheDevices[kCacheMaxDevices];
+static long           gCacheSlabOwner[kCacheNumSlabs];
+static long           gCacheHash[kCacheHashSize];
+static CacheEntry     gCacheEntries[kCacheMaxEntries];
+static char           *gCacheBuffer = (char *)kFSCacheAddr;
+static char           gCacheReadAheadBuffer[kCacheMaxReadAhead];
 
 unsigned long     gCacheHits;
 unsigned long     gCacheMisses;
 unsigned long     gCacheEvicts;
+unsigned long     gCacheReadAheads;
+unsigned long     gCacheReadAheadBlocks;
+unsigned long     gCacheReadAheadHits;
 
 void CacheInit(CICell ih, long blockSize)
 {
+  CacheDevicePtr device, richest;
+  long           cnt, slab, numDevices, share;
+  long           numSlabs, slabs[kCacheNumSlabs];
+  
   if ((blockSize < kCacheMinBlockSize) ||
       (blockSize >= kCacheMaxBlockSize))
     return;
   
-  gCacheBlockSize = blockSize;
-  gCacheNumEntries = kCacheSize / gCacheBlockSize;
-  gCacheTime = 0;
+  if (!gCacheInitialized) {
+    for (cnt = 0; cnt < kCacheHashSize; cnt++) gCacheHash[cnt] = kCacheNoEntry;
+    for (cnt = 0; cnt < kCacheNumSlabs; cnt++)
+      gCacheSlabOwner[cnt] = kCacheNoEntry;
+    gCacheInitialized = 1;
+  }
+  
+  device = CacheFindDevice(ih);
+  if (device != 0) {
+    device->lastInit = ++gCacheInitTime;
+    
+    // Same device and block size; keep what is cached.
+    if (device->blockSize == blockSize) return;
+    
+    // The block size changed, so lay the device's slabs out again.
+    numSlabs = 0;
+    for (slab = 0; slab < kCacheNumSlabs; slab++) {
+      if (gCacheSlabOwner[slab] != (device - gCacheDevices)) continue;
+      CacheRemoveSlab(device, slab);
+      slabs[numSlabs++] = slab;
+    }
+    device->blockSize = blockSize;
+    for (cnt = 0; cnt < numSlabs; cnt++) CacheAddSlab(device, slabs[cnt]);
+    return;
+  }
+  
+  device = CacheNewDevice(ih);
+  device->blockSize = blockSize;
   
-  gCacheHits = 0;
-  gCacheMisses = 0;
-  gCacheEvicts = 0;
+  // Work out an even share of the cache for each device.
+  numDevices = 0;
+  for (cnt = 0; cnt < kCacheMaxDevices; cnt++) {
+    if (gCacheDevices[cnt].ih != 0) numDevices++;
+  }
+  share = kCacheNumSlabs / numDevices;
   
-  bzero(gCacheEntries, sizeof(gCacheEntries));
+  // Take free slabs first.
+  for (slab = 0; (slab < kCacheNumSlabs) && (device->numSlabs < share); slab++) {
+    if (gCacheSlabOwner[slab] == kCacheNoEntry) CacheAddSlab(device, slab);
+  }
   
-  gCacheIH = ih;
+  // Then take slabs from the devices with more than their share.
+  while (device->numSlabs < share) {
+    richest = 0;
+    for (cnt = 0; cnt < kCacheMaxDevices; cnt++) {
+      if ((gCacheDevices[cnt].ih == 0) || (&gCacheDevices[cnt] == device))
+	continue;
+      if ((richest == 0) || (gCacheDevices[cnt].numSlabs > richest->numSlabs))
+	richest = &gCacheDevices[cnt];
+    }
+    if ((richest == 0) || (richest->numSlabs <= share)) break;
+    
+    for (slab = kCacheNumSlabs - 1; slab >= 0; slab--) {
+      if (gCacheSlabOwner[slab] == (richest - gCacheDevices)) break;
+    }
+    CacheRemoveSlab(richest, slab);
+    CacheAddSlab(device, slab);
+  }
 }
 
 
 long CacheRead(CICell ih, char *buffer, long long offset,
 	       long length, long cache)
 {
-  long       cnt, oldestEntry = 0, oldestTime, loadCache = 0;
-  CacheEntry *entry;
+  long           cnt, numBlocks, loadCache = 0;
+  CacheEntry     *entry;
+  CacheDevicePtr device = 0;
   
   // See if the data can be cached.
-  if (cache && (gCacheIH == ih) && (length == gCacheBlockSize)) {
+  if (cache) device = CacheFindDevice(ih);
+  if ((device != 0) && (device->numSlabs != 0) &&
+      (length == device->blockSize)) {
     // Look for the data in the cache.
-    for (cnt = 0; cnt < gCacheNumEntries; cnt++) {
-      entry = &gCacheEntries[cnt];
-      if ((entry->ih == ih) && (entry->offset == offset)) {
-	entry->time = ++gCacheTime;
-	break;
-      }
-    }
+    cnt = CacheLookup(ih, offset);
     
     // If the data was found copy it to the caller.
-    if (cnt != gCacheNumEntries) {
-      bcopy(gCacheBuffer + cnt * gCacheBlockSize, buffer, gCacheBlockSize);
+    if (cnt != kCacheNoEntry) {
+      entry = &gCacheEntries[cnt];
+      if (entry->readAhead) {
+	entry->readAhead = 0;
+	gCacheReadAheadHits++;
+      }
+      
+      // Make it the most recently used entry.
+      if (cnt != device->lruHead) {
+	CacheLRURemove(device, cnt);
+	CacheLRUInsertHead(device, cnt);
+      }
+      bcopy(CacheEntryBuffer(device, cnt), buffer, length);
       gCacheHits++;
-      return gCacheBlockSize;
+      return length;
     }
     
     // Could not find the data in the cache.
     loadCache = 1;
   }
   
+  if (cache) gCacheMisses++;
+  
+  // Read ahead if this miss continues a sequential stream.
+  if (loadCache) {
+    numBlocks = CacheReadAheadBlocks(device, offset);
+    if ((numBlocks > 1) && (CacheReadAhead(device, buffer, offset,
+					   numBlocks) != 0))
+      return length;
+  }
+  
   // Read the data from the disk.
   Seek(ih, offset);
   Read(ih, (CICell)buffer, length);
-  if (cache) gCacheMisses++;
   
   // Put the data from the disk in the cache if needed.
-  if (loadCache) {
-    // Find a free entry.
-    oldestTime = gCacheTime;
-    for (cnt = 0; cnt < gCacheNumEntries; cnt++) {
-      entry = &gCacheEntries[cnt];
-      
-      // Found a free entry.
-      if (entry->ih == 0) break;
-      
-      if (entry->time < oldestTime) {
-	oldestTime = entry->time;
-	oldestEntry = cnt;
-      }
+  if (loadCache) CacheInsert(device, offset, buffer, 0);
+  
+  return length;
+}
+
+// Private functions
+
+static CacheDevicePtr CacheFindDevice(CICell ih)
+{
+  long cnt;
+  
+  if ((gCacheLastDevice != 0) && (gCacheLastDevice->ih == ih))
+    return gCacheLastDevice;
+  
+  for (cnt = 0; cnt < kCacheMaxDevices; cnt++) {
+    if (gCacheDevices[cnt].ih == ih) {
+      gCacheLastDevice = &gCacheDevices[cnt];
+      return gCacheLastDevice;
     }
-    
-    // If no free entry was found, use the oldest.
-    if (cnt == gCacheNumEntries) {
-      cnt = oldestEntry;
-      gCacheEvicts++;
+  }
+  
+  return 0;
+}
+
+static CacheDevicePtr CacheNewDevice(CICell ih)
+{
+  CacheDevicePtr device = 0;
+  long           cnt;
+  
+  // Find a free slot, or else the device initialized longest ago.
+  for (cnt = 0; cnt < kCacheMaxDevices; cnt++) {
+    if (gCacheDevices[cnt].ih == 0) {
+      device = &gCacheDevices[cnt];
+      break;
     }
-    
-    // Copy the data from disk to the new entry.
+    if ((device == 0) || (gCacheDevices[cnt].lastInit < device->lastInit))
+      device = &gCacheDevices[cnt];
+  }
+  
+  if (device->ih != 0) CacheReleaseDevice(device);
+  
+  device->ih = ih;
+  device->numSlabs = 0;
+  device->lruHead = kCacheNoEntry;
+  device->lruTail = kCacheNoEntry;
+  device->lastInit = ++gCacheInitTime;
+  device->streamNext = -1;
+  device->readAhead = 1;
+  
+  return device;
+}
+
+static void CacheReleaseDevice(CacheDevicePtr device)
+{
+  long slab;
+  
+  for (slab = 0; slab < kCacheNumSlabs; slab++) {
+    if (gCacheSlabOwner[slab] == (device - gCacheDevices))
+      CacheRemoveSlab(device, slab);
+  }
+  
+  if (gCacheLastDevice == device) gCacheLastDevice = 0;
+  device->ih = 0;
+}
+
+static void CacheAddSlab(CacheDevicePtr device, long slab)
+{
+  long cnt, numEntries, entryNum;
+  
+  gCacheSlabOwner[slab] = device - gCacheDevices;
+  device->numSlabs++;
+  
+  numEntries = kCacheSlabSize / device->blockSize;
+  for (cnt = 0; cnt < numEntries; cnt++) {
+    entryNum = slab * kCacheSlabEntries + cnt;
+    gCacheEntries[entryNum].ih = 0;
+    CacheLRUInsertTail(device, entryNum);
+  }
+}
+
+static void CacheRemoveSlab(CacheDevicePtr device, long slab)
+{
+  long cnt, numEntries, entryNum;
+  
+  numEntries = kCacheSlabSize / device->blockSize;
+  for (cnt = 0; cnt < numEntries; cnt++) {
+    entryNum = slab * kCacheSlabEntries + cnt;
+    if (gCacheEntries[entryNum].ih != 0) CacheHashRemove(entryNum);
+    gCacheEntries[entryNum].ih = 0;
+    CacheLRURemove(device, entryNum);
+  }
+  
+  gCacheSlabOwner[slab] = kCacheNoEntry;
+  device->numSlabs--;
+}
+
+static long CacheReadAheadBlocks(CacheDevicePtr device, long long offset)
+{
+  long maxBlocks;
+  
+  // A miss on the block after the last disk read continues the stream.
+  if (offset == device->streamNext) device->readAhead *= 2;
+  else device->readAhead = 1;
+  
+  // Don't let read ahead push out more than a quarter of the device's share.
+  maxBlocks = kCacheMaxReadAhead / device->blockSize;
+  if (maxBlocks > (device->numSlabs * kCacheSlabSize / device->blockSize / 4))
+    maxBlocks = device->numSlabs * kCacheSlabSize / device->blockSize / 4;
+  if (device->readAhead > maxBlocks) device->readAhead = maxBlocks;
+  if (device->readAhead < 1) device->readAhead = 1;
+  
+  device->streamNext = offset + device->blockSize;
+  
+  return device->readAhead;
+}
+
+static long CacheReadAhead(CacheDevicePtr device, char *buffer,
+			   long long offset, long numBlocks)
+{
+  long      cnt, actual, blockSize = device->blockSize;
+  long long blockOffset;
+  
+  Seek(device->ih, offset);
+  actual = Read(device->ih, (CICell)gCacheReadAheadBuffer,
+		numBlocks * blockSize);
+  
+  // Let the caller do a plain read if the first block did not make it.
+  if ((actual == kCIError) || (actual < blockSize)) return 0;
+  
+  gCacheReadAheads++;
+  
+  bcopy(gCacheReadAheadBuffer, buffer, blockSize);
+  CacheInsert(device, offset, buffer, 0);
+  
+  // Cache the rest of the blocks that are not already there.
+  numBlocks = actual / blockSize;
+  for (cnt = 1; cnt < numBlocks; cnt++) {
+    blockOffset = offset + cnt * blockSize;
+    if (CacheLookup(device->ih, blockOffset) != kCacheNoEntry) continue;
+    CacheInsert(device, blockOffset,
+		gCacheReadAheadBuffer + cnt * blockSize, 1);
+    gCacheReadAheadBlocks++;
+  }
+  
+  device->streamNext = offset + numBlocks * blockSize;
+  
+  return numBlocks;
+}
+
+static void CacheInsert(CacheDevicePtr device, long long offset,
+			char *buffer, long readAhead)
+{
+  long       cnt, bucket;
+  CacheEntry *entry;
+  
+  // Empty entries are kept at the tail, so the tail is either
+  // free or the least recently used block.
+  cnt = device->lruTail;
+  entry = &gCacheEntries[cnt];
+  if (entry->ih != 0) {
+    CacheHashRemove(cnt);
+    gCacheEvicts++;
+  }
+  CacheLRURemove(device, cnt);
+  
+  // Copy the data from disk to the new entry.
+  entry->ih = device->ih;
+  entry->offset = offset;
+  entry->readAhead = readAhead;
+  bucket = CacheHash(device->ih, offset);
+  entry->hashNext = gCacheHash[bucket];
+  gCacheHash[bucket] = cnt;
+  CacheLRUInsertHead(device, cnt);
+  bcopy(buffer, CacheEntryBuffer(device, cnt), device->blockSize);
+}
+
+static char *CacheEntryBuffer(CacheDevicePtr device, long entryNum)
+{
+  return gCacheBuffer + (entryNum / kCacheSlabEntries) * kCacheSlabSize +
+    (entryNum % kCacheSlabEntries) * device->blockSize;
+}
+
+static long CacheHash(CICell ih, long long offset)
+{
+  u_int32_t key;
+  
+  // Mix the offset in units of the smallest block size with the ih.
+  key = (u_int32_t)(offset / kCacheMinBlockSize) ^ (u_int32_t)ih;
+  
+  return (u_int32_t)(key * 0x9E3779B1) >> (32 - kCacheHashBits);
+}
+
+static long CacheLookup(CICell ih, long long offset)
+{
+  long       cnt;
+  CacheEntry *entry;
+  
+  cnt = gCacheHash[CacheHash(ih, offset)];
+  while (cnt != kCacheNoEntry) {
     entry = &gCacheEntries[cnt];
-    entry->ih = ih;
-    entry->time = ++gCacheTime;
-    entry->offset = offset;
-    bcopy(buffer, gCacheBuffer + cnt * gCacheBlockSize, gCacheBlockSize);
+    if ((entry->ih == ih) && (entry->offset == offset)) break;
+    cnt = entry->hashNext;
   }
   
-  return length;
+  return cnt;
+}
+
+static void CacheLRURemove(CacheDevicePtr device, long entryNum)
+{
+  CacheEntry *entry = &gCacheEntries[entryNum];
+  
+  if (entry->lruPrev != kCacheNoEntry)
+    gCacheEntries[entry->lruPrev].lruNext = entry->lruNext;
+  else device->lruHead = entry->lruNext;
+  
+  if (entry->lruNext != kCacheNoEntry)
+    gCacheEntries[entry->lruNext].lruPrev = entry->lruPrev;
+  else device->lruTail = entry->lruPrev;
+}
+
+static void CacheLRUInsertHead(CacheDevicePtr device, long entryNum)
+{
+  CacheEntry *entry = &gCacheEntries[entryNum];
+  
+  entry->lruPrev = kCacheNoEntry;
+  entry->lruNext = device->lruHead;
+  
+  if (device->lruHead != kCacheNoEntry)
+    gCacheEntries[device->lruHead].lruPrev = entryNum;
+  else device->lruTail = entryNum;
+  
+  device->lruHead = entryNum;
+}
+
+static void CacheLRUInsertTail(CacheDevicePtr device, long entryNum)
+{
+  CacheEntry *entry = &gCacheEntries[entryNum];
+  
+  entry->lruNext = kCacheNoEntry;
+  entry->lruPrev = device->lruTail;
+  
+  if (device->lruTail != kCacheNoEntry)
+    gCacheEntries[device->lruTail].lruNext = entryNum;
+  else device->lruHead = entryNum;
+  
+  device->lruTail = entryNum;
+}
+
+static void CacheHashRemove(long entryNum)
+{
+  CacheEntry *entry = &gCacheEntries[entryNum];
+  long       *link;
+  
+  link = &gCacheHash[CacheHash(entry->ih, entry->offset)];
+  while (*link != kCacheNoEntry) {
+    if (*link == entryNum) {
+      *link = entry->hashNext;
+      break;
+    }
+    link = &gCacheEntries[*link].hashNext;
+  }
 }
@@ -47,6 +47,7 @@ static long ReadDirEntry(InodePtr dirInode, long *fileInodeNum,
 			 long *dirIndex, char **name);
 static long FindFileInDir(char *fileName, long *flags,
                           InodePtr fileInode, InodePtr dirInode);
+static long GetDiskBlockNum(InodePtr fileInode, long blockNum);
 static char *ReadFileBlock(InodePtr fileInode, long blockNum, long blockOffset,
 			   long length, char *buffer, long cache);
 static long ReadFile(InodePtr fileInode, long *length);
@@ -58,6 +59,7 @@ static struct m_ext2fs *gFS;
 static long            gBlockSize;
 static long            gBlockSizeOld;
 static char            *gTempBlock;
+static char            *gDirBlock;
 static char            gTempName[EXT2FS_MAXNAMLEN + 1];
 static char            gTempName2[EXT2FS_MAXNAMLEN + 1];
 static Inode           gRootInode;
@@ -87,6 +89,7 @@ long Ext2InitPartition(CICell ih)
   gBlockSize = 1024 << gFS->e2fs.e2fs_log_bsize;
   if (gBlockSizeOld <= gBlockSize) {
     gTempBlock = AllocateBootXMemory(gBlockSize);
+    gDirBlock = AllocateBootXMemory(gBlockSize);
   }
   CacheInit(ih, gBlockSize);
   
@@ -169,6 +172,58 @@ long Ext2GetDirEntry(CICell ih, char *dirPath, long *dirIndex,
   return 0;
 }
 
+
+long Ext2GetDirEntries(CICell ih, char *dirPath, long *dirIndex,
+		       DirEntryPtr entries, long maxEntries)
+{
+  long                 ret, dirFlags, numEntries = 0;
+  long                 blockNum, offset, reclen, inodeNum;
+  char                 *buffer;
+  struct ext2fs_direct *dir;
+  Inode                tmpInode;
+  
+  if (Ext2InitPartition(ih) == -1) return -1;
+  
+  // Skip a leading '\' if present
+  if (dirPath[0] == '\\') dirPath++;
+  ret = ResolvePathToInode(dirPath, &dirFlags, &gFileInode, &gRootInode);
+  if ((ret == -1) || ((dirFlags & kFileTypeMask) != kFileTypeDirectory))
+    return -1;
+  
+  // Decode a whole directory block at a time.  The block is copied
+  // since ReadInode reuses the temp block.
+  while (numEntries < maxEntries) {
+    offset   = *dirIndex % gBlockSize;
+    blockNum = *dirIndex / gBlockSize;
+    
+    buffer = ReadFileBlock(&gFileInode, blockNum, 0, gBlockSize, gDirBlock, 1);
+    if (buffer == 0) break;
+    
+    while ((numEntries < maxEntries) && (offset < gBlockSize)) {
+      dir = (struct ext2fs_direct *)(gDirBlock + offset);
+      reclen = bswap16(dir->e2d_reclen);
+      if (reclen == 0) {
+	*dirIndex += gBlockSize - offset;
+	break;
+      }
+      
+      offset += reclen;
+      *dirIndex += reclen;
+      
+      inodeNum = bswap32(dir->e2d_ino);
+      if (inodeNum == 0) continue;
+      
+      ReadInode(inodeNum, &tmpInode, &entries[numEntries].flags,
+		&entries[numEntries].time);
+      strncpy(entries[numEntries].name, dir->e2d_name, dir->e2d_namlen);
+      entries[numEntries].name[dir->e2d_namlen] = '\0';
+      numEntries++;
+    }
+  }
+  
+  return numEntries;
+}
+
 // XX no support in AppleFileSystemDriver yet
 long Ext2GetUUID(CICell ih, char *uuidStr)
 {
@@ -320,13 +375,12 @@ static long FindFileInDir(char *fileName, long *flags,
 }
 
 
-static char *ReadFileBlock(InodePtr fileInode, long blockNum, long blockOffset,
-			   long length, char *buffer, long cache)
+static long GetDiskBlockNum(InodePtr fileInode, long blockNum)
 {
   long diskBlockNum, indBlockNum, indBlockOff, refsPerBlock;
   char *indBlock;
   
-  if (blockNum >= fileInode->e2di_nblock) return 0;
+  if (blockNum >= fileInode->e2di_nblock) return -1;
   
   refsPerBlock = gBlockSize / sizeof(u_int32_t);
   
@@ -367,6 +421,17 @@ static char *ReadFileBlock(InodePtr fileInode, long blockNum, long blockOffset,
     diskBlockNum = bswap32(((u_int32_t *)indBlock)[blockNum]);
   }
   
+  return diskBlockNum;
+}
+
+static char *ReadFileBlock(InodePtr fileInode, long blockNum, long blockOffset,
+			   long length, char *buffer, long cache)
+{
+  long diskBlockNum;
+  
+  diskBlockNum = GetDiskBlockNum(fileInode, blockNum);
+  if (diskBlockNum == -1) return 0;
+  
   buffer = ReadBlock(diskBlockNum, blockOffset, length, buffer, cache);
   
   return buffer;
@@ -374,8 +439,8 @@ static char *ReadFileBlock(InodePtr fileInode, long blockNum, long blockOffset,
 
 static long ReadFile(InodePtr fileInode, long *length)
 {
-  long bytesLeft, curSize, curBlock = 0;
-  char *buffer, *curAddr = (char *)kLoadAddr;
+  long bytesLeft, curSize, curBlock = 0, diskBlockNum, numBlocks;
+  char *curAddr = (char *)kLoadAddr;
   
   bytesLeft = *length = fileInode->e2di_size;
   
@@ -385,13 +450,21 @@ static long ReadFile(InodePtr fileInode, long *length)
   }
   
   while (bytesLeft) {
-    if (bytesLeft > gBlockSize) curSize = gBlockSize;
+    diskBlockNum = GetDiskBlockNum(fileInode, curBlock);
+    if (diskBlockNum == -1) break;
+    
+    // Read the blocks that follow this one on disk in the same Read.
+    for (numBlocks = 1; (numBlocks * gBlockSize) < bytesLeft; numBlocks++) {
+      if (GetDiskBlockNum(fileInode, curBlock + numBlocks) !=
+	  (diskBlockNum + numBlocks)) break;
+    }
+    
+    if (bytesLeft > (numBlocks * gBlockSize)) curSize = numBlocks * gBlockSize;
     else curSize = bytesLeft;
     
-    buffer = ReadFileBlock(fileInode, curBlock, 0, curSize, curAddr, 0);
-    if (buffer == 0) break;
+    ReadBlock(diskBlockNum, 0, curSize, curAddr, 0);
     
-    curBlock++;
+    curBlock += numBlocks;
     curAddr += curSize;
     bytesLeft -= curSize;
   }
@@ -37,6 +37,9 @@ typedef long (* FSReadFile)(CICell ih, char *filePath,
 typedef long (* FSGetDirEntry)(CICell ih, char *dirPath,
 			       long *dirIndex, char **name,
 			       long *flags, long *time);
+typedef long (* FSGetDirEntries)(CICell ih, char *dirPath,
+				 long *dirIndex, DirEntryPtr entries,
+				 long maxEntries);
 typedef long (* FSGetUUID)(CICell ih, char *uuidStr);
 
 #define kPartNet     (0)
@@ -50,6 +53,7 @@ struct PartInfo {
   FSLoadFile      loadFile;
   FSReadFile      readFile;
   FSGetDirEntry   getDirEntry;
+  FSGetDirEntries getDirEntries;
   FSGetUUID       getUUID;
   char            partName[1024];
 };
@@ -87,6 +91,29 @@ long LoadFile(char *fileSpec)
   return length;
 }
 
+// Read part of a file into any buffer.  Returns -1 if the
+// file system can only load whole files at kLoadAddr.
+long ReadFileAt(char *fileSpec, void *base,
+		unsigned long offset, unsigned long length)
+{
+  char       devSpec[256];
+  char       *filePath;
+  FSReadFile readFile;
+  long       ret, partIndex;
+  
+  ret = ConvertFileSpec(fileSpec, devSpec, &filePath);
+  if ((ret == -1) || (filePath == NULL)) return -1;
+  
+  // Get the partition index for devSpec.
+  partIndex = LookupPartition(devSpec);
+  if (partIndex == -1) return -1;
+  
+  readFile = gParts[partIndex].readFile;
+  if (readFile == NULL) return -1;
+  
+  return readFile(gParts[partIndex].partIH, filePath, base, offset, length);
+}
+
 long LoadThinFatFile(char *fileSpec, void **binary)
 {
   char       devSpec[256];
@@ -258,6 +285,42 @@ long GetDirEntry(char *dirSpec, long *dirIndex, char **name,
   return ret;
 }
 
+long GetDirEntries(char *dirSpec, long *dirIndex,
+		   DirEntryPtr entries, long maxEntries)
+{
+  char            devSpec[256];
+  char            *dirPath, *name;
+  FSGetDirEntry   getDirEntry;
+  FSGetDirEntries getDirEntries;
+  long            ret, partIndex, cnt;
+  
+  ret = ConvertFileSpec(dirSpec, devSpec, &dirPath);
+  if ((ret == -1) || (dirPath == NULL)) return -1;
+  
+  // Get the partition index for devSpec.
+  partIndex = LookupPartition(devSpec);
+  if (partIndex == -1) return -1;
+  
+  getDirEntries = gParts[partIndex].getDirEntries;
+  if (getDirEntries != NULL) {
+    return getDirEntries(gParts[partIndex].partIH, dirPath,
+			 dirIndex, entries, maxEntries);
+  }
+  
+  // Fall back to one entry at a time.
+  getDirEntry = gParts[partIndex].getDirEntry;
+  for (cnt = 0; cnt < maxEntries; cnt++) {
+    ret = getDirEntry(gParts[partIndex].partIH, dirPath, dirIndex,
+		      &name, &entries[cnt].flags, &entries[cnt].time);
+    if (ret == -1) break;
+    
+    strncpy(entries[cnt].name, name, kDirEntryNameSize - 1);
+    entries[cnt].name[kDirEntryNameSize - 1] = '\0';
+  }
+  
+  return cnt;
+}
+
 long DumpDir(char *dirSpec)
 {
   long ret, flags, time, index = 0;
@@ -334,6 +397,7 @@ long LookupPartition(char *devSpec)
       gParts[partIndex].loadFile      = NetLoadFile;
       gParts[partIndex].readFile      = NULL;
       gParts[partIndex].getDirEntry   = NetGetDirEntry;
+      gParts[partIndex].getDirEntries = NULL;
       gParts[partIndex].getUUID       = NULL;
       break;
       
@@ -341,6 +405,7 @@ long LookupPartition(char *devSpec)
       gParts[partIndex].loadFile      = HFSLoadFile;
       gParts[partIndex].readFile      = HFSReadFile;
       gParts[partIndex].getDirEntry   = HFSGetDirEntry;
+      gParts[partIndex].getDirEntries = HFSGetDirEntries;
       gParts[partIndex].getUUID       = HFSGetUUID;
       break;
       
@@ -348,6 +413,7 @@ long LookupPartition(char *devSpec)
       gParts[partIndex].loadFile      = UFSLoadFile;
       gParts[partIndex].readFile      = UFSReadFile;
       gParts[partIndex].getDirEntry   = UFSGetDirEntry;
+      gParts[partIndex].getDirEntries = UFSGetDirEntries;
       gParts[partIndex].getUUID       = UFSGetUUID;
       break;
       
@@ -355,6 +421,7 @@ long LookupPartition(char *devSpec)
       gParts[partIndex].loadFile      = Ext2LoadFile;
       gParts[partIndex].readFile      = NULL;
       gParts[partIndex].getDirEntry   = Ext2GetDirEntry;
+      gParts[partIndex].getDirEntries = Ext2GetDirEntries;
       gParts[partIndex].getUUID       = NULL;
       // Ext2GetUUID exists, but there's no kernel support
       break;
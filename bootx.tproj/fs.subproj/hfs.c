@@ -37,6 +37,44 @@
 #define kBTreeCatalog (0)
 #define kBTreeExtents (1)
 
+// Resolved extent maps for files that use the extents overflow file.
+#define kExtentMapMaxFiles   (8)
+#define kExtentMapMaxExtents (1024)
+
+struct ExtentMapExtent {
+  long fileBlock;
+  long startBlock;
+  long blockCount;
+};
+typedef struct ExtentMapExtent ExtentMapExtent, *ExtentMapExtentPtr;
+
+struct ExtentMap {
+  CICell ih;		// 0 for an unused map
+  long   fileID;
+  long   firstExtent;
+  long   numExtents;
+  long   lastUse;
+};
+typedef struct ExtentMap ExtentMap, *ExtentMapPtr;
+
+// Catalog lookups by (parentID, name), including ones that failed.
+// The cache is four way set associative.
+#define kCatalogCacheSets      (32)
+#define kCatalogCacheWays      (4)
+#define kCatalogCacheNameSize  (64)
+#define kCatalogCacheEntrySize (264)
+
+struct CatalogCacheEntry {
+  CICell ih;		// 0 for an unused entry
+  long   dirID;
+  long   result;
+  long   dirIndex;
+  long   lastUse;
+  char   name[kCatalogCacheNameSize];
+  char   entry[kCatalogCacheEntrySize];
+};
+typedef struct CatalogCacheEntry CatalogCacheEntry, *CatalogCacheEntryPtr;
+
 static CICell                  gCurrentIH;
 static long long               gAllocationOffset;
 static long                    gIsHFSPlus;
@@ -50,6 +88,17 @@ static char                    gHFSPlusHeader[kBlockSize];
 static HFSPlusVolumeHeader     *gHFSPlus =(HFSPlusVolumeHeader*)gHFSPlusHeader;
 static char                    gLinkTemp[64];
 static long long               gVolID;
+static ExtentMap               gExtentMaps[kExtentMapMaxFiles];
+static ExtentMapExtent         gExtentMapExtents[kExtentMapMaxExtents];
+static long                    gExtentMapNextExtent;
+static long                    gExtentMapTime;
+static CatalogCacheEntry       gCatalogCache[kCatalogCacheSets *
+					     kCatalogCacheWays];
+static long                    gCatalogCacheTime;
+
+unsigned long                  gCatalogCacheHits;
+unsigned long                  gCatalogCacheMisses;
+unsigned long                  gCatalogCacheNodeReadsSaved;
 
 
 static long ReadFile(void *file, long *length, void *base, long offset);
@@ -59,8 +108,11 @@ static long ResolvePathToCatalogEntry(char *filePath, long *flags,
 
 static long GetCatalogEntry(long *dirIndex, char **name,
 			    long *flags, long *time);
+static void GetCatalogEntryName(void *key, char *name, long nameSize);
 static long ReadCatalogEntry(char *fileName, long dirID, void *entry,
 			     long *dirIndex);
+static CatalogCacheEntryPtr LookupCatalogCache(char *fileName, long dirID,
+					       long *found);
 static long ReadExtentsEntry(long fileID, long startBlock, void *entry);
 
 static long ReadBTreeEntry(long btree, void *key, char *entry, long *dirIndex);
@@ -69,6 +121,11 @@ static void GetBTreeRecord(long index, char *nodeBuffer, long nodeSize,
 
 static long ReadExtent(char *extent, long extentSize, long extentFile,
 		       long offset, long size, void *buffer, long cache);
+static ExtentMapPtr GetExtentMap(char *extent, long extentSize,
+				 long extentFile);
+static long BuildExtentMap(char *extent, long extentSize, long extentFile);
+static ExtentMapExtentPtr FindExtentMapExtent(ExtentMapPtr map,
+					      long blockNumber);
 
 static long GetExtentStart(void *extents, long index);
 static long GetExtentSize(void *extents, long index);
@@ -115,7 +172,6 @@ long HFSInitPartition(CICell ih)
     if (gHFSMDB->drEmbedSigWord != kHFSPlusSigWord) {
       // Normal HFS;
       gBlockSize = gHFSMDB->drAlBlkSiz;
-      CacheInit(ih, gBlockSize);
       gCurrentIH = ih;
 
       // grab the 64 bit volume ID
@@ -129,8 +185,9 @@ long HFSInitPartition(CICell ih)
 		 gBTreeHeaderBuffer + kBTreeCatalog * 256, 0);
       nodeSize = ((BTHeaderRec *)(gBTreeHeaderBuffer + kBTreeCatalog * 256 + sizeof(BTNodeDescriptor)))->nodeSize;
       
-      // If the BTree node size is larger than the block size, reset the cache.
-      if (nodeSize > gBlockSize) CacheInit(ih, nodeSize);
+      // Cache in BTree nodes if they are larger than the block size.
+      // The cache keeps this device's blocks if the size is unchanged.
+      CacheInit(ih, (nodeSize > gBlockSize) ? nodeSize : gBlockSize);
       
       return 0;
     }
@@ -151,7 +208,6 @@ long HFSInitPartition(CICell ih)
         
   gIsHFSPlus = 1;
   gBlockSize = gHFSPlus->blockSize;
-  CacheInit(ih, gBlockSize);
   gCurrentIH = ih;
   
   // grab the 64 bit volume ID
@@ -165,8 +221,9 @@ long HFSInitPartition(CICell ih)
 	     gBTreeHeaderBuffer + kBTreeCatalog * 256, 0);
   nodeSize = ((BTHeaderRec *)(gBTreeHeaderBuffer + kBTreeCatalog * 256 + sizeof(BTNodeDescriptor)))->nodeSize;
   
-  // If the BTree node size is larger than the block size, reset the cache.
-  if (nodeSize > gBlockSize) CacheInit(ih, nodeSize);
+  // Cache in BTree nodes if they are larger than the block size.
+  // The cache keeps this device's blocks if the size is unchanged.
+  CacheInit(ih, (nodeSize > gBlockSize) ? nodeSize : gBlockSize);
   
   return 0;
 }
@@ -250,6 +307,95 @@ long HFSGetDirEntry(CICell ih, char *dirPath, long *dirIndex, char **name,
   return 0;
 }
 
+long HFSGetDirEntries(CICell ih, char *dirPath, long *dirIndex,
+		      DirEntryPtr entries, long maxEntries)
+{
+  char             entry[512];
+  long             dirID, dirFlags, extentSize, nodeSize, curNode, index;
+  long             numEntries = 0;
+  void             *extent;
+  char             *nodeBuf, *testKey, *recordData;
+  BTNodeDescriptor *node;
+  
+  if (HFSInitPartition(ih) == -1) return -1;
+  
+  if (*dirIndex == -1) return 0;
+  
+  dirID = kHFSRootFolderID;
+  // Skip a lead '\'.  Start in the system folder if there are two.
+  if (dirPath[0] == '\\') {
+    if (dirPath[1] == '\\') {
+      if (gIsHFSPlus) dirID = ((long *)gHFSPlus->finderInfo)[5];
+      else dirID = gHFSMDB->drFndrInfo[5];
+      if (dirID == 0) return -1;
+      dirPath++;
+    }
+    dirPath++;
+  }
+  
+  if (*dirIndex == 0) {
+    ResolvePathToCatalogEntry(dirPath, &dirFlags, entry, dirID, dirIndex);
+    if (*dirIndex == 0) *dirIndex = -1;
+    if ((dirFlags & kFileTypeMask) != kFileTypeUnknown) return -1;
+    if (*dirIndex == -1) return 0;
+  }
+  
+  if (gIsHFSPlus) {
+    extent     = &gHFSPlus->catalogFile.extents;
+    extentSize = gHFSPlus->catalogFile.logicalSize;
+  } else {
+    extent     = (HFSExtentDescriptor *)&gHFSMDB->drCTExtRec;
+    extentSize = gHFSMDB->drCTFlSize;
+  }
+  
+  nodeSize = gBTHeaders[kBTreeCatalog]->nodeSize;
+  nodeBuf = (char *)malloc(nodeSize);
+  if (nodeBuf == 0) return -1;
+  node = (BTNodeDescriptor *)nodeBuf;
+  
+  index   = *dirIndex % nodeSize;
+  curNode = *dirIndex / nodeSize;
+  
+  // Decode the leaf nodes a whole node at a time.
+  while (numEntries < maxEntries) {
+    ReadExtent(extent, extentSize, kHFSCatalogFileID,
+	       curNode * nodeSize, nodeSize, nodeBuf, 1);
+    
+    for (; index < node->numRecords; index++) {
+      if (numEntries == maxEntries) break;
+      
+      GetBTreeRecord(index, nodeBuf, nodeSize, &testKey, &recordData);
+      GetCatalogEntryInfo(recordData, &entries[numEntries].flags,
+			  &entries[numEntries].time);
+      
+      // The thread record for the next directory ends this one.
+      if ((entries[numEntries].flags & kFileTypeMask) == kFileTypeUnknown) {
+	curNode = 0;
+	break;
+      }
+      
+      GetCatalogEntryName(testKey, entries[numEntries].name,
+			  kDirEntryNameSize);
+      numEntries++;
+    }
+    
+    if (curNode == 0) break;
+    if (index < node->numRecords) break;
+    
+    // Move on to the next leaf node.
+    index = 0;
+    curNode = node->fLink;
+    if (curNode == 0) break;
+  }
+  
+  if (curNode == 0) *dirIndex = -1;
+  else *dirIndex = curNode * nodeSize + index;
+  
+  free(nodeBuf);
+  
+  return numEntries;
+}
+
 long HFSGetUUID(CICell ih, char *uuidStr)
 {
   if (HFSInitPartition(ih) == -1) return -1;
@@ -433,15 +579,7 @@ static long GetCatalogEntry(long *dirIndex, char **name,
   GetCatalogEntryInfo(entry, flags, time);
   
   // Get the file name.
-  if (gIsHFSPlus) {
-    utf_encodestr(((HFSPlusCatalogKey *)testKey)->nodeName.unicode,
-		  ((HFSPlusCatalogKey *)testKey)->nodeName.length,
-		  gTempStr, 256);
-  } else {
-    strncpy(gTempStr,
-	    &((HFSCatalogKey *)testKey)->nodeName[1],
-	    ((HFSCatalogKey *)testKey)->nodeName[0]);
-  }
+  GetCatalogEntryName(testKey, gTempStr, 256);
   *name = gTempStr;
   
   // Update dirIndex.
@@ -457,13 +595,43 @@ static long GetCatalogEntry(long *dirIndex, char **name,
   return 0;
 }
 
+static void GetCatalogEntryName(void *key, char *name, long nameSize)
+{
+  long length;
+  
+  if (gIsHFSPlus) {
+    utf_encodestr(((HFSPlusCatalogKey *)key)->nodeName.unicode,
+		  ((HFSPlusCatalogKey *)key)->nodeName.length,
+		  name, nameSize);
+  } else {
+    length = ((HFSCatalogKey *)key)->nodeName[0];
+    if (length > (nameSize - 1)) length = nameSize - 1;
+    strncpy(name, &((HFSCatalogKey *)key)->nodeName[1], length);
+    name[length] = '\0';
+  }
+}
+
 static long ReadCatalogEntry(char *fileName, long dirID,
 			     void *entry, long *dirIndex)
 {
-  long              length;
-  char              key[sizeof(HFSPlusCatalogKey)];
-  HFSCatalogKey     *hfsKey     = (HFSCatalogKey *)key;
-  HFSPlusCatalogKey *hfsPlusKey = (HFSPlusCatalogKey *)key;
+  long                 length, result, found, tmpDirIndex;
+  char                 key[sizeof(HFSPlusCatalogKey)];
+  HFSCatalogKey        *hfsKey     = (HFSCatalogKey *)key;
+  HFSPlusCatalogKey    *hfsPlusKey = (HFSPlusCatalogKey *)key;
+  CatalogCacheEntryPtr cacheEntry;
+  
+  // Look for the entry in the catalog cache.
+  cacheEntry = LookupCatalogCache(fileName, dirID, &found);
+  if (found) {
+    gCatalogCacheHits++;
+    if (gBTHeaders[kBTreeCatalog] != 0) {
+      gCatalogCacheNodeReadsSaved += gBTHeaders[kBTreeCatalog]->treeDepth;
+    }
+    if (cacheEntry->result == -1) return -1;
+    bcopy(cacheEntry->entry, entry, kCatalogCacheEntrySize);
+    if (dirIndex != 0) *dirIndex = cacheEntry->dirIndex;
+    return 0;
+  }
   
   // Make the catalog key.
   if (gIsHFSPlus) {
@@ -480,7 +648,55 @@ static long ReadCatalogEntry(char *fileName, long dirID,
     strncpy(hfsKey->nodeName + 1, fileName, length);
   }
   
-  return ReadBTreeEntry(kBTreeCatalog, &key, entry, dirIndex);
+  result = ReadBTreeEntry(kBTreeCatalog, &key, entry, &tmpDirIndex);
+  if ((result == 0) && (dirIndex != 0)) *dirIndex = tmpDirIndex;
+  
+  // Save the result if the name fits in the cache.
+  if (cacheEntry != 0) {
+    gCatalogCacheMisses++;
+    cacheEntry->ih       = gCurrentIH;
+    cacheEntry->dirID    = dirID;
+    cacheEntry->result   = result;
+    cacheEntry->dirIndex = tmpDirIndex;
+    strcpy(cacheEntry->name, fileName);
+    if (result == 0) bcopy(entry, cacheEntry->entry, kCatalogCacheEntrySize);
+  }
+  
+  return result;
+}
+
+static CatalogCacheEntryPtr LookupCatalogCache(char *fileName, long dirID,
+					       long *found)
+{
+  long                 cnt, hash = dirID;
+  char                 *name = fileName;
+  CatalogCacheEntryPtr set, cacheEntry;
+  
+  *found = 0;
+  
+  while (*name != '\0') hash = hash * 31 + *name++;
+  if ((name - fileName) >= kCatalogCacheNameSize) return 0;
+  
+  // Names are compared exactly, so a name that only matches in
+  // the B-tree by case gets its own entry.
+  set = &gCatalogCache[((unsigned long)hash % kCatalogCacheSets) *
+		       kCatalogCacheWays];
+  cacheEntry = set;
+  for (cnt = 0; cnt < kCatalogCacheWays; cnt++) {
+    if ((set[cnt].ih == gCurrentIH) && (set[cnt].dirID == dirID) &&
+	!strcmp(set[cnt].name, fileName)) {
+      *found = 1;
+      set[cnt].lastUse = ++gCatalogCacheTime;
+      return &set[cnt];
+    }
+    if (set[cnt].lastUse < cacheEntry->lastUse) cacheEntry = &set[cnt];
+  }
+  
+  // Hand back the least recently used entry for the caller to fill in.
+  cacheEntry->ih = 0;
+  cacheEntry->lastUse = ++gCatalogCacheTime;
+  
+  return cacheEntry;
 }
 
 static long ReadExtentsEntry(long fileID, long startBlock, void *entry)
@@ -654,11 +870,15 @@ static long ReadExtent(char *extent, long extentSize,
 		       void *buffer, long cache)
 {
   long      lastOffset, blockNumber, countedBlocks = 0;
-  long      nextExtent = 0, sizeRead = 0, readSize;
+  long      nextExtent = 0, sizeRead = 0, readSize, cnt;
+  long      extentStart, extentBlocks, inlineBlocks = 0;
   long      nextExtentBlock, currentExtentBlock = 0;
-  long long readOffset;
-  long      extentDensity, sizeofExtent, currentExtentSize;
+  long long readOffset, pendingOffset = 0;
+  long      extentDensity, sizeofExtent, currentExtentSize, pendingSize = 0;
   char      *currentExtent, *extentBuffer = 0, *bufferPos = buffer;
+  char      *pendingBuffer = buffer;
+  ExtentMapPtr       map = 0;
+  ExtentMapExtentPtr mapExtent;
   
   if (offset >= extentSize) return 0;
   
@@ -670,66 +890,213 @@ static long ReadExtent(char *extent, long extentSize,
     sizeofExtent = sizeof(HFSExtentDescriptor);
   }
   
+  // Use a resolved extent map if the file has overflow extents.
+  // The extents file itself never does.
+  if (extentFile != kHFSExtentsFileID) {
+    for (cnt = 0; cnt < extentDensity; cnt++) {
+      inlineBlocks += GetExtentSize(extent, cnt);
+    }
+    if (((long long)inlineBlocks * gBlockSize) < (offset + size)) {
+      map = GetExtentMap(extent, extentSize, extentFile);
+    }
+  }
+  
   lastOffset = offset + size;
   while (offset < lastOffset) {
     blockNumber = offset / gBlockSize;
     
-    // Find the extent for the offset.
-    for (; ; nextExtent++) {
-      if (nextExtent < extentDensity) {
-	if ((countedBlocks+GetExtentSize(extent, nextExtent)-1)<blockNumber) {
-	  countedBlocks += GetExtentSize(extent, nextExtent);
-	  continue;
-	}
+    if (map != 0) {
+      mapExtent = FindExtentMapExtent(map, blockNumber);
+      if (mapExtent == 0) break;
+      
+      countedBlocks = mapExtent->fileBlock;
+      extentStart   = mapExtent->startBlock;
+      extentBlocks  = mapExtent->blockCount;
+    } else {
+      // Find the extent for the offset.
+      for (; ; nextExtent++) {
+	if (nextExtent < extentDensity) {
+	  if ((countedBlocks+GetExtentSize(extent, nextExtent)-1)<blockNumber) {
+	    countedBlocks += GetExtentSize(extent, nextExtent);
+	    continue;
+	  }
 	
-	currentExtent = extent + nextExtent * sizeofExtent;
-	break;
-      }
+	  currentExtent = extent + nextExtent * sizeofExtent;
+	  break;
+	}
       
-      if (extentBuffer == 0) {
-	extentBuffer = malloc(sizeofExtent * extentDensity);
-	if (extentBuffer == 0) return -1;
-      }
+	if (extentBuffer == 0) {
+	  extentBuffer = malloc(sizeofExtent * extentDensity);
+	  if (extentBuffer == 0) return -1;
+	}
       
-      nextExtentBlock = nextExtent / extentDensity;
-      if (currentExtentBlock != nextExtentBlock) {
-	ReadExtentsEntry(extentFile, countedBlocks, extentBuffer);
-	currentExtentBlock = nextExtentBlock;
-      }
+	nextExtentBlock = nextExtent / extentDensity;
+	if (currentExtentBlock != nextExtentBlock) {
+	  ReadExtentsEntry(extentFile, countedBlocks, extentBuffer);
+	  currentExtentBlock = nextExtentBlock;
+	}
       
-      currentExtentSize = GetExtentSize(extentBuffer,
-					nextExtent % extentDensity);
+	currentExtentSize = GetExtentSize(extentBuffer,
+					  nextExtent % extentDensity);
       
-      if ((countedBlocks + currentExtentSize - 1) >= blockNumber) {
-	currentExtent = extentBuffer + sizeofExtent *
-	  (nextExtent % extentDensity);
-	break;
-      }
+	if ((countedBlocks + currentExtentSize - 1) >= blockNumber) {
+	  currentExtent = extentBuffer + sizeofExtent *
+	    (nextExtent % extentDensity);
+	  break;
+	}
       
-      countedBlocks += currentExtentSize;
+	countedBlocks += currentExtentSize;
+      }
+    
+      extentStart  = GetExtentStart(currentExtent, 0);
+      extentBlocks = GetExtentSize(currentExtent, 0);
     }
     
     readOffset = ((blockNumber - countedBlocks) * gBlockSize) +
       (offset % gBlockSize);
     
-    readSize = GetExtentSize(currentExtent, 0) * gBlockSize - readOffset;
+    readSize = extentBlocks * gBlockSize - readOffset;
     if (readSize > (size - sizeRead)) readSize = size - sizeRead;
     
-    readOffset += (long long)GetExtentStart(currentExtent, 0) * gBlockSize;
+    readOffset += (long long)extentStart * gBlockSize;
+    readOffset += gAllocationOffset;
     
-    CacheRead(gCurrentIH, bufferPos, gAllocationOffset + readOffset,
-	      readSize, cache);
+    // Extents that follow each other on disk are read together.
+    if ((cache == 0) && (pendingSize != 0) &&
+	(readOffset == (pendingOffset + pendingSize))) {
+      pendingSize += readSize;
+    } else {
+      if (pendingSize != 0) {
+	CacheRead(gCurrentIH, pendingBuffer, pendingOffset, pendingSize, cache);
+      }
+      pendingOffset = readOffset;
+      pendingSize = readSize;
+      pendingBuffer = bufferPos;
+    }
     
     sizeRead += readSize;
     offset += readSize;
     bufferPos += readSize;
   }
   
+  if (pendingSize != 0) {
+    CacheRead(gCurrentIH, pendingBuffer, pendingOffset, pendingSize, cache);
+  }
+  
   if (extentBuffer) free(extentBuffer);
   
   return sizeRead;
 }
 
+static ExtentMapPtr GetExtentMap(char *extent, long extentSize,
+				 long extentFile)
+{
+  long         cnt, numExtents;
+  ExtentMapPtr map;
+  
+  for (cnt = 0; cnt < kExtentMapMaxFiles; cnt++) {
+    map = &gExtentMaps[cnt];
+    if ((map->ih == gCurrentIH) && (map->fileID == extentFile)) {
+      map->lastUse = ++gExtentMapTime;
+      return map;
+    }
+  }
+  
+  // Start over with an empty pool if this file does not fit.
+  numExtents = BuildExtentMap(extent, extentSize, extentFile);
+  if (numExtents == -1) {
+    for (cnt = 0; cnt < kExtentMapMaxFiles; cnt++) gExtentMaps[cnt].ih = 0;
+    gExtentMapNextExtent = 0;
+    numExtents = BuildExtentMap(extent, extentSize, extentFile);
+    if (numExtents == -1) return 0;
+  }
+  
+  // Use a free map or the least recently used one.
+  map = &gExtentMaps[0];
+  for (cnt = 0; cnt < kExtentMapMaxFiles; cnt++) {
+    if (gExtentMaps[cnt].ih == 0) {
+      map = &gExtentMaps[cnt];
+      break;
+    }
+    if (gExtentMaps[cnt].lastUse < map->lastUse) map = &gExtentMaps[cnt];
+  }
+  
+  map->ih          = gCurrentIH;
+  map->fileID      = extentFile;
+  map->firstExtent = gExtentMapNextExtent;
+  map->numExtents  = numExtents;
+  map->lastUse     = ++gExtentMapTime;
+  
+  gExtentMapNextExtent += numExtents;
+  
+  return map;
+}
+
+static long BuildExtentMap(char *extent, long extentSize, long extentFile)
+{
+  long               cnt, countedBlocks = 0, numExtents = 0;
+  long               extentDensity, fileBlocks, blockCount;
+  char               extentRecord[sizeof(HFSPlusExtentRecord)];
+  char               *currentRecord = extent;
+  ExtentMapExtentPtr mapExtents = gExtentMapExtents + gExtentMapNextExtent;
+  
+  if (gIsHFSPlus) extentDensity = kHFSPlusExtentDensity;
+  else extentDensity = kHFSExtentDensity;
+  
+  fileBlocks = (extentSize + gBlockSize - 1) / gBlockSize;
+  
+  // Add the extents from the catalog record, then each overflow record.
+  while (countedBlocks < fileBlocks) {
+    for (cnt = 0; cnt < extentDensity; cnt++) {
+      blockCount = GetExtentSize(currentRecord, cnt);
+      if (blockCount == 0) break;
+      
+      if ((gExtentMapNextExtent + numExtents) == kExtentMapMaxExtents) {
+	return -1;
+      }
+      
+      mapExtents[numExtents].fileBlock  = countedBlocks;
+      mapExtents[numExtents].startBlock = GetExtentStart(currentRecord, cnt);
+      mapExtents[numExtents].blockCount = blockCount;
+      numExtents++;
+      
+      countedBlocks += blockCount;
+    }
+    
+    if (countedBlocks >= fileBlocks) break;
+    
+    // A short or missing record ends the map early.
+    if ((cnt != extentDensity) ||
+	(ReadExtentsEntry(extentFile, countedBlocks, extentRecord) == -1)) {
+      break;
+    }
+    currentRecord = extentRecord;
+  }
+  
+  return numExtents;
+}
+
+static ExtentMapExtentPtr FindExtentMapExtent(ExtentMapPtr map,
+					      long blockNumber)
+{
+  long               lowerBound, upperBound, index;
+  ExtentMapExtentPtr mapExtent;
+  
+  lowerBound = map->firstExtent;
+  upperBound = map->firstExtent + map->numExtents - 1;
+  while (lowerBound <= upperBound) {
+    index = (lowerBound + upperBound) / 2;
+    mapExtent = &gExtentMapExtents[index];
+    
+    if (blockNumber < mapExtent->fileBlock) upperBound = index - 1;
+    else if (blockNumber >= (mapExtent->fileBlock + mapExtent->blockCount)) {
+      lowerBound = index + 1;
+    } else return mapExtent;
+  }
+  
+  return 0;
+}
+
 static long GetExtentStart(void *extents, long index)
 {
   long                    start;
@@ -44,6 +44,7 @@ static long ReadDirEntry(InodePtr dirInode, long *fileInodeNum,
 			 long *dirIndex, char **name);
 static long FindFileInDir(char *fileName, long *flags,
 			  InodePtr fileInode, InodePtr dirInode);
+static long GetDiskFragNum(InodePtr fileInode, long fragNum);
 static char *ReadFileBlock(InodePtr fileInode, long fragNum, long blockOffset,
 			   long length, char *buffer, long cache);
 static long ReadFile(InodePtr fileInode, long *length,
@@ -188,6 +189,58 @@ long UFSGetDirEntry(CICell ih, char *dirPath, long *dirIndex,
   return 0;
 }
 
+
+long UFSGetDirEntries(CICell ih, char *dirPath, long *dirIndex,
+		      DirEntryPtr entries, long maxEntries)
+{
+  long          ret, dirFlags, numEntries = 0;
+  long          dirBlockNum, dirBlockOffset;
+  char          dirBlock[DIRBLKSIZ], *buffer;
+  struct direct *dir;
+  Inode         tmpInode;
+  
+  if (UFSInitPartition(ih) == -1) return -1;
+  
+  // Skip a leading '\' if present
+  if (*dirPath == '\\') dirPath++;
+  if (*dirPath == '\\') dirPath++;
+  ret = ResolvePathToInode(dirPath, &dirFlags, &gFileInode, &gRootInode);
+  if ((ret == -1) || ((dirFlags & kFileTypeMask) != kFileTypeDirectory))
+    return -1;
+  
+  // Decode a whole directory block at a time.  The block is copied
+  // since ReadInode reuses the temp block.
+  while (numEntries < maxEntries) {
+    dirBlockOffset = *dirIndex % DIRBLKSIZ;
+    dirBlockNum    = *dirIndex / DIRBLKSIZ;
+    
+    buffer = ReadFileBlock(&gFileInode, dirBlockNum, 0, DIRBLKSIZ,
+			   dirBlock, 1);
+    if (buffer == 0) break;
+    
+    while ((numEntries < maxEntries) && (dirBlockOffset < DIRBLKSIZ)) {
+      dir = (struct direct *)(dirBlock + dirBlockOffset);
+      if (dir->d_reclen == 0) {
+	*dirIndex += DIRBLKSIZ - dirBlockOffset;
+	break;
+      }
+      
+      dirBlockOffset += dir->d_reclen;
+      *dirIndex += dir->d_reclen;
+      
+      if (dir->d_ino == 0) continue;
+      
+      ReadInode(dir->d_ino, &tmpInode, &entries[numEntries].flags,
+		&entries[numEntries].time);
+      strncpy(entries[numEntries].name, dir->d_name, dir->d_namlen);
+      entries[numEntries].name[dir->d_namlen] = '\0';
+      numEntries++;
+    }
+  }
+  
+  return numEntries;
+}
+
 // Private functions
 
 static char *ReadBlock(long fragNum, long blockOffset, long length,
@@ -332,15 +385,14 @@ static long FindFileInDir(char *fileName, long *flags,
 }
 
 
-static char *ReadFileBlock(InodePtr fileInode, long fragNum, long blockOffset,
-			   long length, char *buffer, long cache)
+static long GetDiskFragNum(InodePtr fileInode, long fragNum)
 {
   long fragCount, blockNum;
   long diskFragNum, indFragNum, indBlockOff, refsPerBlock;
   char *indBlock;
   
   fragCount = (fileInode->di_size + gFragSize - 1) / gFragSize;
-  if (fragNum >= fragCount) return 0;
+  if (fragNum >= fragCount) return -1;
   
   refsPerBlock = gBlockSize / sizeof(ufs_daddr_t);
   
@@ -384,7 +436,19 @@ static char *ReadFileBlock(InodePtr fileInode, long fragNum, long blockOffset,
     diskFragNum = ((ufs_daddr_t *)indBlock)[blockNum];
   }
   
-  buffer = ReadBlock(diskFragNum+fragNum, blockOffset, length, buffer, cache);
+  return diskFragNum + fragNum;
+}
+
+
+static char *ReadFileBlock(InodePtr fileInode, long fragNum, long blockOffset,
+			   long length, char *buffer, long cache)
+{
+  long diskFragNum;
+  
+  diskFragNum = GetDiskFragNum(fileInode, fragNum);
+  if (diskFragNum == -1) return 0;
+  
+  buffer = ReadBlock(diskFragNum, blockOffset, length, buffer, cache);
   
   return buffer;
 }
@@ -392,8 +456,8 @@ static char *ReadFileBlock(InodePtr fileInode, long fragNum, long blockOffset,
 
 static long ReadFile(InodePtr fileInode, long *length, void *base, long offset)
 {
-  long bytesLeft, curSize, curFrag;
-  char *buffer, *curAddr = (char *)base;
+  long bytesLeft, curSize, curFrag, diskFragNum, numBlocks;
+  char *curAddr = (char *)base;
   
   bytesLeft = fileInode->di_size;
   
@@ -416,16 +480,24 @@ static long ReadFile(InodePtr fileInode, long *length, void *base, long offset)
   offset %= gBlockSize;
   
   while (bytesLeft) {
-    curSize = gBlockSize;
+    diskFragNum = GetDiskFragNum(fileInode, curFrag);
+    if (diskFragNum == -1) break;
+    
+    // Read the blocks that follow this one on disk in the same Read.
+    for (numBlocks = 1; (numBlocks * gBlockSize - offset) < bytesLeft;
+	 numBlocks++) {
+      if (GetDiskFragNum(fileInode, curFrag + numBlocks * gFragsPerBlock) !=
+	  (diskFragNum + numBlocks * gFragsPerBlock)) break;
+    }
+    
+    curSize = numBlocks * gBlockSize - offset;
     if (curSize > bytesLeft) curSize = bytesLeft;
-    if (offset != 0) curSize -= offset;
     
-    buffer = ReadFileBlock(fileInode, curFrag, offset, curSize, curAddr, 0);
-    if (buffer == 0) break;
+    ReadBlock(diskFragNum, offset, curSize, curAddr, 0);
     
     if (offset != 0) offset = 0;
     
-    curFrag += gFragsPerBlock;
+    curFrag += numBlocks * gFragsPerBlock;
     curAddr += curSize;
     bytesLeft -= curSize;
   }
@@ -172,9 +172,14 @@ typedef struct CIArgs CIArgs;
 
 typedef long (*ClientInterfacePtr)(CIArgs *args);
 
+// Count and time every client interface call by service, for
+// development builds only.
+#define kCIProfile (0)
+
 // ci.c
 long InitCI(ClientInterfacePtr ciPtr);
 long CallCI(CIArgs *ciArgsPtr);
+void SaveCIProfile(void);
 
 // Device Tree
 CICell Peer(CICell phandle);
@@ -30,12 +30,26 @@
 #ifndef _BOOTX_FS_H_
 #define _BOOTX_FS_H_
 
+// One entry returned by GetDirEntries.
+#define kDirEntryNameSize (256)
+
+struct DirEntry {
+  long flags;
+  long time;
+  char name[kDirEntryNameSize];
+};
+typedef struct DirEntry DirEntry, *DirEntryPtr;
+
 // Externs for fs.c
 extern long LoadFile(char *fileSpec);
 extern long LoadThinFatFile(char *fileSpec, void **binary);
+extern long ReadFileAt(char *fileSpec, void *base,
+		       unsigned long offset, unsigned long length);
 extern long GetFileInfo(char *dirSpec, char *name, long *flags, long *time);
 extern long GetDirEntry(char *dirSpec, long *dirIndex, char **name,
 			long *flags, long *time);
+extern long GetDirEntries(char *dirSpec, long *dirIndex,
+			  DirEntryPtr entries, long maxEntries);
 extern long DumpDir(char *dirSpec);
 extern long GetFSUUID(char *devSpec, char *uuidStr);
 extern long CreateUUIDString(uint8_t uubytes[], int nbytes, char *uuidStr);
@@ -44,6 +58,9 @@ extern long CreateUUIDString(uint8_t uubytes[], int nbytes, char *uuidStr);
 extern unsigned long gCacheHits;
 extern unsigned long gCacheMisses;
 extern unsigned long gCacheEvicts;
+extern unsigned long gCacheReadAheads;
+extern unsigned long gCacheReadAheadBlocks;
+extern unsigned long gCacheReadAheadHits;
 
 extern void CacheInit(CICell ih, long chunkSize);
 extern long CacheRead(CICell ih, char *buffer, long long offset,
@@ -57,6 +74,10 @@ extern long   NetGetDirEntry(CICell ih, char *dirPath,
 			     long *flags, long *time);
 
 // Externs for hfs.c
+extern unsigned long gCatalogCacheHits;
+extern unsigned long gCatalogCacheMisses;
+extern unsigned long gCatalogCacheNodeReadsSaved;
+
 extern long HFSInitPartition(CICell ih);
 extern long HFSLoadFile(CICell ih, char *filePath);
 extern long HFSReadFile(CICell ih, char *filePath,
@@ -65,6 +86,8 @@ extern long HFSReadFile(CICell ih, char *filePath,
 extern long HFSGetDirEntry(CICell ih, char *dirPath,
 			   long *dirIndex, char **name,
 			   long *flags, long *time);
+extern long HFSGetDirEntries(CICell ih, char *dirPath, long *dirIndex,
+			     DirEntryPtr entries, long maxEntries);
 extern long HFSGetUUID(CICell ih, char *uuidStr);
 
 // Externs for ufs.c
@@ -76,6 +99,8 @@ extern long UFSReadFile(CICell ih, char *filePath,
 extern long UFSGetDirEntry(CICell ih, char *dirPath,
 			   long *dirIndex, char **name,
 			   long *flags, long *time);
+extern long UFSGetDirEntries(CICell ih, char *dirPath, long *dirIndex,
+			     DirEntryPtr entries, long maxEntries);
 extern long UFSGetUUID(CICell ih, char *uuidStr);
 
 // Externs for ext2.c
@@ -84,6 +109,8 @@ extern long Ext2LoadFile(CICell ih, char *filePath);
 extern long Ext2GetDirEntry(CICell ih, char *dirPath,
 			   long *dirIndex, char **name,
 			    long *flags, long *time);
+extern long Ext2GetDirEntries(CICell ih, char *dirPath, long *dirIndex,
+			      DirEntryPtr entries, long maxEntries);
 extern long Ext2GetUUID(CICell ih, char *uuidStr);
 
 #endif /* ! _BOOTX_FS_H_ */
@@ -40,6 +40,7 @@
 // ci_io.c
 extern int putchar(int ch);
 extern int puts(const char *str);
+extern void FlushOutput(void);
 
 // prf.c
 extern void prf(const char *fmt, unsigned int *adx, int (*putfn_p)(int ch),
@@ -79,6 +80,7 @@ extern void *realloc(void *start, size_t newsize);
 
 // mem.c
 extern void *memcpy(void *dst, const void *src, size_t len);
+extern void *memmove(void *dst, const void *src, size_t len);
 extern void *memset(void *dst, int ch, size_t len);
 extern int memcmp(const void *b1, const void *b2, size_t len);
 extern void bcopy(const void *src, void *dst, size_t len);
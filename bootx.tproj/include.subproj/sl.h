@@ -172,6 +172,15 @@ struct Tag {
 };
 typedef struct Tag Tag, *TagPtr;
 
+// types for lzss.c
+struct lzss_stream {
+  u_int8_t  *dststart;
+  u_int8_t  *dst;
+  int       checksum;
+  u_int32_t adler32;
+};
+typedef struct lzss_stream lzss_stream;
+
 // Externs for main.c
 extern char *gVectorSaveAddr;
 extern long gKernelEntryPoint;
@@ -181,6 +190,8 @@ extern long gBootArgsAddr;
 extern long gBootArgsSize;
 extern long gSymbolTableAddr;
 extern long gSymbolTableSize;
+extern long gImageLastKernelAddr;
+extern long gImageFirstBootXAddr;
 
 extern long gBootMode;
 extern long gBootDeviceType;
@@ -222,11 +233,17 @@ extern long MatchThis(CICell phandle, char *string);
 extern void *AllocateBootXMemory(long size);
 extern long AllocateKernelMemory(long size);
 extern long AllocateMemoryRange(char *rangeName, long start, long length);
+
+// Externs for adler32.c
+extern void InitAdler32(void);
 extern unsigned long Adler32(unsigned char *buffer, long length);
+extern unsigned long UpdateAdler32(unsigned long adler,
+				   unsigned char *buffer, long length);
 
 // Externs for macho.c
 extern long ThinFatBinaryMachO(void **binary, unsigned long *length);
 extern long DecodeMachO(void *binary);
+extern long DecodeMachOFile(char *fileSpec);
 
 // Externs for elf.c
 extern long ThinFatBinaryElf(void **binary, unsigned long *length);
@@ -258,6 +275,12 @@ extern long ParseConfigFile(char *addr);
 
 // Externs for lzss.c
 extern int decompress_lzss(u_int8_t *dst, u_int8_t *src, u_int32_t srclen);
+extern int decompress_lzss_adler32(u_int8_t *dst, u_int8_t *src,
+				   u_int32_t srclen, u_int32_t *adler32);
+extern void decompress_lzss_start(lzss_stream *stream, u_int8_t *dst,
+				  int checksum);
+extern u_int32_t decompress_lzss_chunk(lzss_stream *stream, u_int8_t *src,
+				       u_int32_t srclen, int last);
 
 
 // Externs for plist.c
@@ -266,11 +289,23 @@ extern int decompress_lzss(u_int8_t *dst, u_int8_t *src, u_int32_t srclen);
 extern TagPtr GetProperty(TagPtr dict, char *key);
 extern long ParseXML(char *buffer, TagPtr *dict);
 extern void FreeTag(TagPtr tag);
+extern void InitTagArena(char *addr, long size);
+extern void FreeTagArena(void);
+extern TagPtr KeepTag(TagPtr tag);
+extern long RelocateTags(char *base, long length, TagPtr tags, long numTags);
 #if PLIST_DEBUG
 extern void DumpTag(TagPtr tag, long depth);
 #endif
 
 
+// Externs for timeline.c
+extern void InitTimeline(void);
+extern void TimelineBegin(char *name, long arg);
+extern void TimelineEnd(char *name, long arg);
+extern void TimelineMark(char *name, long arg);
+extern void SaveTimeline(void);
+
+
 // Externs/types for raid.c
 typedef struct RAIDMember *RAIDDevicePtr;
 
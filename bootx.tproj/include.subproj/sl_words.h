@@ -58,6 +58,12 @@ extern void Emit(char ch);
 //    calls cr ( -- )
 extern void CR(void);
 
+//  slw_type ( addr len -- )               Output Level: 2
+//    calls type ( addr len -- )
+
+//  slw_type_cr ( addr len -- )            Output Level: 2
+//    calls type ( addr len -- ) then cr ( -- )
+
 //  slw_init_keymap ( keyboardIH -- keyMap )
 //  sets the ihandle for the keyboard and
 //  puts the address of the keyMap on the stack
@@ -75,8 +81,13 @@ extern void SpinInit(CICell screenIH, char *cursorAddr,
 		     long frames, long fps,
 		     long pixelSize, long spare);
 
+// SpinInitFrameBuffer
+//    Lets Spin draw the wait cursor into the frame buffer itself.
+extern void SpinInitFrameBuffer(char *baseAddr, long rowBytes);
+
 // slw_spin ( -- )
-//    Spins the wait cursor.
+//    Spins the wait cursor, calling slw_spin only if there
+//    is no timebase to time it with.
 extern void Spin(void);
 
 extern long GetPackageProperty(CICell phandle, char *propName,
@@ -31,48 +31,158 @@
 #import <ci.h>
 
 
+// Copies, fills and compares move a word at a time once the
+// destination is aligned, eight words (a 32 byte cache line) per loop.
+// Bytes are only used at the ends.  When the source can not be aligned
+// with the destination its words are loaded misaligned, which the
+// PowerPC handles in hardware.
+
+#define kWordMask (sizeof(long) - 1)
+
+static long GetZeroLineSize(void);
+
+// Size of the cache block cleared by dcbz, 0 until it has
+// been measured and -1 if dcbz should not be used.
+static long gZeroLineSize;
+
+
+// memcpy copies forwards only; use memmove or bcopy for buffers
+// that overlap.
+
 void *memcpy(void *dst, const void *src, size_t len)
 {
   const char *s = src;
   char       *d = dst;
-  int        pos = 0, dir = 1;
-
-  if (d > s) {
-    dir = -1;
-    pos = len - 1;
+  
+  if (len >= 4 * sizeof(long)) {
+    while ((long)d & kWordMask) {
+      *d++ = *s++;
+      len--;
+    }
+    
+    while (len >= 8 * sizeof(long)) {
+      ((long *)d)[0] = ((const long *)s)[0];
+      ((long *)d)[1] = ((const long *)s)[1];
+      ((long *)d)[2] = ((const long *)s)[2];
+      ((long *)d)[3] = ((const long *)s)[3];
+      ((long *)d)[4] = ((const long *)s)[4];
+      ((long *)d)[5] = ((const long *)s)[5];
+      ((long *)d)[6] = ((const long *)s)[6];
+      ((long *)d)[7] = ((const long *)s)[7];
+      d += 8 * sizeof(long);
+      s += 8 * sizeof(long);
+      len -= 8 * sizeof(long);
+    }
+    
+    while (len >= sizeof(long)) {
+      *(long *)d = *(const long *)s;
+      d += sizeof(long);
+      s += sizeof(long);
+      len -= sizeof(long);
+    }
   }
+  
+  while (len--) *d++ = *s++;
+  
+  return dst;
+}
 
-  while (len--) {
-    d[pos] = s[pos];
-    pos += dir;
-  }
 
+void *memmove(void *dst, const void *src, size_t len)
+{
+  const char *s = src;
+  char       *d = dst;
+  
+  // Only a destination inside the source has to be copied backwards.
+  if ((d <= s) || (d >= (s + len))) return memcpy(dst, src, len);
+  
+  s += len;
+  d += len;
+  
+  // Each word is read before the words below it are written, so
+  // whole words can be moved as long as they do not overlap.
+  if ((len >= 4 * sizeof(long)) && ((d - s) >= sizeof(long))) {
+    while ((long)d & kWordMask) {
+      *--d = *--s;
+      len--;
+    }
+    
+    while (len >= sizeof(long)) {
+      d -= sizeof(long);
+      s -= sizeof(long);
+      *(long *)d = *(const long *)s;
+      len -= sizeof(long);
+    }
+  }
+  
+  while (len--) *--d = *--s;
+  
   return dst;
 }
 
 
 void *memset(void *dst, int ch, size_t len)
 {
-  long tmp = 0x01010101 * (ch & 0x000000FF);
-
-  if (len < 32) while (len--) *(((char *)dst)++) = ch;
-  else {
+  char *d = dst;
+  long tmp = (ch & 0x000000FF) * (~0UL / 0xFF);  // ch in every byte
+  long lineSize, lineMask;
+  
+  if (len >= 4 * sizeof(long)) {
     // do the front chunk as chars
-    while ((long)dst & 3) {
+    while ((long)d & kWordMask) {
+      *d++ = ch;
       len--;
-      *(((char *)dst)++) = ch;
+    }
+    
+    // Clear whole cache blocks with dcbz, which zeros them in the
+    // cache without reading them from memory first.
+    if ((tmp == 0) && (len >= 1024)) {
+      lineSize = gZeroLineSize;
+      if (lineSize == 0) lineSize = gZeroLineSize = GetZeroLineSize();
+      
+      if (lineSize > 0) {
+	lineMask = lineSize - 1;
+	
+	while ((long)d & lineMask) {
+	  *(long *)d = 0;
+	  d += sizeof(long);
+	  len -= sizeof(long);
+	}
+	
+	while (len >= lineSize) {
+#if defined(__ppc__)
+	  __asm__ volatile("dcbz 0, %0" : : "r" (d) : "memory");
+#endif
+	  d += lineSize;
+	  len -= lineSize;
+	}
+      }
     }
     
     // do the middle chunk as longs
-    while (len > 3) {
-      len -= 4;
-      *(((long *)dst)++) = tmp;
+    while (len >= 8 * sizeof(long)) {
+      ((long *)d)[0] = tmp;
+      ((long *)d)[1] = tmp;
+      ((long *)d)[2] = tmp;
+      ((long *)d)[3] = tmp;
+      ((long *)d)[4] = tmp;
+      ((long *)d)[5] = tmp;
+      ((long *)d)[6] = tmp;
+      ((long *)d)[7] = tmp;
+      d += 8 * sizeof(long);
+      len -= 8 * sizeof(long);
     }
     
-    // do the last chunk as chars
-    while (len--) *(((char *)dst)++) = ch;
+    while (len >= sizeof(long)) {
+      *(long *)d = tmp;
+      d += sizeof(long);
+      len -= sizeof(long);
+    }
   }
-
+  
+  // do the last chunk as chars
+  while (len--) *d++ = ch;
+  
   return dst;
 }
 
@@ -80,22 +190,37 @@ void *memset(void *dst, int ch, size_t len)
 int
 memcmp(const void *b1, const void *b2, size_t len)
 {
-  register long n = len;
-  unsigned char *m1 = (unsigned char *)b1;
-  unsigned char *m2 = (unsigned char *)b2;
+  const unsigned char *m1 = b1;
+  const unsigned char *m2 = b2;
+  
+  // Skip the matching words, then find the first different byte.
+  if ((len >= 4 * sizeof(long)) && ((((long)m1 ^ (long)m2) & kWordMask) == 0)) {
+    while ((long)m1 & kWordMask) {
+      if (*m1 != *m2) return *m1 - *m2;
+      m1++;
+      m2++;
+      len--;
+    }
+    
+    while ((len >= sizeof(long)) &&
+	   (*(const long *)m1 == *(const long *)m2)) {
+      m1 += sizeof(long);
+      m2 += sizeof(long);
+      len -= sizeof(long);
+    }
+  }
   
-  while (n-- && (*m1 == *m2)) {
-    m1++;
-    m2++;
+  for (; len > 0; len--, m1++, m2++) {
+    if (*m1 != *m2) return *m1 - *m2;
   }
   
-  return ((n < 0) ? 0 : (*m1 - *m2));
+  return 0;
 }
 
 
 void bcopy(const void *src, void *dst, size_t len)
 {
-  memcpy(dst, src, len);
+  memmove(dst, src, len);
 }
 
 void bzero(void *dst, int len)
@@ -103,3 +228,31 @@ void bzero(void *dst, int len)
   memset(dst, 0, len);
 }
 
+
+// Measure how much dcbz clears: the G3 and G4 clear 32 bytes and
+// the G5 clears 128 unless it has been set up to act like a G4.
+
+static long GetZeroLineSize(void)
+{
+#if defined(__ppc__)
+  char  buffer[3 * 128];
+  char  *line = (char *)(((long)buffer + 127) & ~127);
+  long  cnt;
+  
+  for (cnt = 0; cnt < 2 * 128; cnt++) line[cnt] = 1;
+  
+  __asm__ volatile("dcbz 0, %0" : : "r" (line + 128) : "memory");
+  
+  for (cnt = 0; cnt < 128; cnt++) {
+    if (line[128 + cnt] != 0) break;
+  }
+  
+  // Anything else, or dcbz reaching below the line, is not trusted.
+  if ((line[127] == 0) || ((cnt != 32) && (cnt != 64) && (cnt != 128)))
+    return -1;
+  
+  return cnt;
+#else
+  return -1;
+#endif
+}
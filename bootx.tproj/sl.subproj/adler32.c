@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2000-2005 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ * 
+ * The contents of this file constitute Original Code as defined in and
+ * are subject to the Apple Public Source License Version 1.1 (the
+ * "License").  You may not use this file except in compliance with the
+ * License.  Please obtain a copy of the License at
+ * http://www.apple.com/publicsource and read it before using this file.
+ * 
+ * This Original Code and all software distributed under the License are
+ * distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON-INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * @APPLE_LICENSE_HEADER_END@
+ */
+/*
+ *  adler32.c - Adler-32 checksum for the mkext and kernelcache
+ *
+ *  Copyright (c) 2000-2005 Apple Computer, Inc.
+ *
+ *  DRI: Josh de Cesare
+ *  code split out from main.c, 2005
+ */
+
+#include <sl.h>
+
+#define BASE 65521L /* largest prime smaller than 65536 */
+
+// s1 is kept in 32 bits and s2 in 64 bits, so the sums only need to be
+// reduced once per kAdlerBlockSize bytes; 255 * 4MB + BASE still fits in s1.
+#define kAdlerBlockSize (0x400000)
+
+// The AltiVec unit is only used for runs long enough to pay for
+// turning it on.  kVectorBlocks is the most 16 byte blocks that can be
+// summed before the 32 bit lanes of the s2 vectors could overflow.
+#define kAltiVecMinLength (256)
+#define kVectorBlocks     (2048)
+
+#define kMSRVEC (0x02000000)
+
+// A user process can not touch the MSR, so a build for one, like the
+// host tests, sets ADLER32_USER to leave it alone.  Mac OS X turns the
+// vector unit on for a process when it is first used.
+#ifndef ADLER32_USER
+#define ADLER32_USER (0)
+#endif
+
+#define DO1(buf,i)  {a += buf[i]; b += a;}
+#define DO2(buf,i)  DO1(buf,i); DO1(buf,i+1);
+#define DO4(buf,i)  DO2(buf,i); DO2(buf,i+2);
+#define DO8(buf,i)  DO4(buf,i); DO4(buf,i+4);
+#define DO16(buf)   DO8(buf,0); DO8(buf,8);
+
+static void ScalarAdler32(unsigned long *s1, unsigned long long *s2,
+			  unsigned char *buf, long len);
+static unsigned long ReduceAdler32(unsigned long long sum);
+#if defined(__VEC__)
+static void VectorAdler32(unsigned long *s1, unsigned long long *s2,
+			  unsigned char *buf, long len)
+  __attribute__((noinline));
+#endif
+
+static long gHasAltiVec;
+
+
+void InitAdler32(void)
+{
+#if defined(__ppc__)
+  unsigned long pvr;
+  
+  __asm__ volatile("mfpvr %0" : "=r" (pvr));
+  
+  switch (pvr >> 16) {
+  case 0x000C : // 7400
+  case 0x800C : // 7410
+  case 0x8000 : // 7450
+  case 0x8001 : // 7445, 7455
+  case 0x8002 : // 7447, 7457
+  case 0x8003 : // 7447A
+  case 0x8004 : // 7448
+  case 0x0039 : // 970
+  case 0x003C : // 970FX
+  case 0x0044 : // 970MP
+    gHasAltiVec = 1;
+    break;
+    
+  default :
+    gHasAltiVec = 0;
+    break;
+  }
+#else
+  gHasAltiVec = 0;
+#endif
+}
+
+
+unsigned long Adler32(unsigned char *buf, long len)
+{
+  return UpdateAdler32(1, buf, len);
+}
+
+
+unsigned long UpdateAdler32(unsigned long adler, unsigned char *buf, long len)
+{
+  unsigned long      s1 = adler & 0xffff;
+  unsigned long long s2 = (adler >> 16) & 0xffff;
+  long               k;
+#if defined(__VEC__)
+#if !ADLER32_USER
+  unsigned long      msr;
+#endif
+  long               head;
+#endif
+  
+  while (len > 0) {
+    k = len < kAdlerBlockSize ? len : kAdlerBlockSize;
+    len -= k;
+    
+#if defined(__VEC__)
+    if (gHasAltiVec && (k >= kAltiVecMinLength)) {
+      // Sum up to the first 16 byte boundary by hand.
+      head = -(long)buf & 15;
+      ScalarAdler32(&s1, &s2, buf, head);
+      buf += head;
+      k -= head;
+      
+      // Firmware leaves the vector unit off, so turn it on around
+      // the vector loop.
+#if !ADLER32_USER
+      __asm__ volatile("mfmsr %0" : "=r" (msr));
+      __asm__ volatile("mtmsr %0" : : "r" (msr | kMSRVEC));
+      __asm__ volatile("isync");
+#endif
+      
+      VectorAdler32(&s1, &s2, buf, k & ~15);
+      
+#if !ADLER32_USER
+      __asm__ volatile("mtmsr %0" : : "r" (msr));
+      __asm__ volatile("isync");
+#endif
+      
+      buf += k & ~15;
+      k &= 15;
+    }
+#endif
+    
+    ScalarAdler32(&s1, &s2, buf, k);
+    buf += k;
+    
+    s1 %= BASE;
+    s2 = ReduceAdler32(s2);
+  }
+  
+  return (s2 << 16) | s1;
+}
+
+
+static void ScalarAdler32(unsigned long *s1, unsigned long long *s2,
+			  unsigned char *buf, long len)
+{
+  unsigned long      a, b, t1 = *s1;
+  unsigned long long t2 = *s2;
+  
+  // Each block of 16 is summed in 32 bits, then
+  // s2 picks up 16 * s1 plus the block's own s2.
+  while (len >= 16) {
+    a = b = 0;
+    DO16(buf);
+    t2 += ((unsigned long long)t1 << 4) + b;
+    t1 += a;
+    buf += 16;
+    len -= 16;
+  }
+  
+  while (len-- > 0) {
+    t1 += *buf++;
+    t2 += t1;
+  }
+  
+  *s1 = t1;
+  *s2 = t2;
+}
+
+
+static unsigned long ReduceAdler32(unsigned long long sum)
+{
+  unsigned long long high;
+  
+  // 2^16 is 15 mod BASE, so fold the high half down
+  // until a 32 bit divide will do.
+  while ((sum >> 32) != 0) {
+    high = sum >> 16;
+    sum = (high << 4) - high + (sum & 0xffff);
+  }
+  
+  return (unsigned long)sum % BASE;
+}
+
+
+#if defined(__VEC__)
+// buf must be 16 byte aligned and len a multiple of 16.
+// For each lane, vs1 collects the byte sums, vps the running
+// total of vs1 before each block and vs2 the bytes weighted
+// by their distance from the end of the block.
+
+static void VectorAdler32(unsigned long *s1, unsigned long long *s2,
+			  unsigned char *buf, long len)
+{
+  vector unsigned char weights = (vector unsigned char)
+    (16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+  vector unsigned int  zero = vec_splat_u32(0);
+  vector unsigned int  vs1, vs2, vps;
+  vector unsigned char data;
+  union {
+    vector unsigned int v;
+    unsigned long       s[4];
+  } sum1, sum2, sumps;
+  unsigned long        t1 = *s1, cnt, blocks;
+  unsigned long long   t2 = *s2;
+  
+  while (len > 0) {
+    blocks = len >> 4;
+    if (blocks > kVectorBlocks) blocks = kVectorBlocks;
+    len -= blocks << 4;
+    
+    vs1 = vs2 = vps = zero;
+    for (cnt = 0; cnt < blocks; cnt++) {
+      data = vec_ld(0, buf);
+      vps = vec_add(vps, vs1);
+      vs1 = vec_sum4s(data, vs1);
+      vs2 = vec_msum(data, weights, vs2);
+      buf += 16;
+    }
+    
+    sum1.v = vs1;
+    sum2.v = vs2;
+    sumps.v = vps;
+    
+    t2 += (unsigned long long)t1 * (blocks << 4);
+    for (cnt = 0; cnt < 4; cnt++) {
+      t2 += ((unsigned long long)sumps.s[cnt] << 4) + sum2.s[cnt];
+      t1 += sum1.s[cnt];
+    }
+  }
+  
+  *s1 = t1;
+  *s2 = t2;
+}
+#endif
@@ -31,9 +31,19 @@
 #include <device_tree.h>
 
 
+static long FlatenTree(CICell rootPH);
+static long DefineFlatenWords(void);
 static long FlatenNode(CICell ph, long nodeAddr, long *nodeSize);
 static long FlatenProps(CICell ph, long propAddr, long *propSize,
 			long *numProps);
+static long GetUnitString(CICell ph, char **unitString);
+
+// Have Open Firmware flatten the tree itself with FlatenTree.  Leave
+// this off until the two ways have been compared on real firmware,
+// which SL_DEBUG does.
+#define kFlatenInForth (0)
+
+static long gFlatenWordsDefined;
 
 // Public Functions
 
@@ -47,7 +57,25 @@ long FlattenDeviceTree(void)
   RootPH = Peer(0);
   if (RootPH == kCIError) return -1;
   
-  ret = FlatenNode(RootPH, gDeviceTreeAddr, &gDeviceTreeSize);
+  // Have Open Firmware walk the tree itself if it is allowed to
+  // and can, else walk it from here a property at a time.
+  ret = kFlatenInForth ? FlatenTree(RootPH) : -1;
+  if (ret != 0) {
+    ret = FlatenNode(RootPH, gDeviceTreeAddr, &gDeviceTreeSize);
+  }
+#if SL_DEBUG
+  else {
+    long *mmTmp = gDeviceTreeMMTmp, size;
+    char *copy = (char *)gDeviceTreeAddr + gDeviceTreeSize;
+    
+    // Both ways should give the same bytes.
+    FlatenNode(RootPH, (long)copy, &size);
+    if ((size != gDeviceTreeSize) ||
+	memcmp((char *)gDeviceTreeAddr, copy, size))
+      printf("FlatenTree and FlatenNode differ\n");
+    gDeviceTreeMMTmp = mmTmp;
+  }
+#endif
   
   AllocateKernelMemory(gDeviceTreeSize);
   
@@ -134,6 +162,118 @@ CICell SearchForNodeMatching(CICell ph, long top, char *value)
 
 // Private Functions
 
+// Flatten the tree in one call to Open Firmware instead of several
+// per property.
+
+static long FlatenTree(CICell rootPH)
+{
+  long ret, size, mmAddr;
+  
+  if (gOFVersion < kOFVersion3x) return -1;
+  
+  if (!gFlatenWordsDefined) {
+    gFlatenWordsDefined = 1;
+    if (DefineFlatenWords() != 0) gFlatenWordsDefined = -1;
+  }
+  if (gFlatenWordsDefined != 1) return -1;
+  
+  mmAddr = 0;
+  ret = Interpret(3, 2, " slw_flatten",
+		  gMemoryMapPH, gDeviceTreeAddr, rootPH, &size, &mmAddr);
+  if (ret != kCINoError) return -1;
+  
+  gDeviceTreeSize = size;
+  if (mmAddr != 0) gDeviceTreeMMTmp = (long *)mmAddr;
+  
+  return 0;
+}
+
+
+// Define the words FlatenTree uses.  They write the same DTNode and
+// DTProperty layout as FlatenNode and FlatenProps.
+
+static long DefineFlatenWords(void)
+{
+  return Interpret(0, 0,
+     " hex"
+     " 0 value dtAddr"
+     " 0 value dtMMPH"
+     " 0 value dtMMAddr"
+     
+     // slw_dt_name ( str len -- str' len' )
+     " : slw_dt_name"
+     "   1F min >r dtAddr r@ move 0 dtAddr r@ + c! dtAddr r>"
+     " ;"
+     
+     // slw_dt_value ( addr len -- )
+     " : slw_dt_value"
+     "   dup dtAddr 20 + l!"
+     "   >r dtAddr 24 + r@ 100000 min move"
+     "   dtAddr 24 + r> 3 + -4 and + to dtAddr"
+     " ;"
+     
+     // slw_dt_mm? ( str len -- flag )
+     " : slw_dt_mm?"
+     "   \" DeviceTree\" rot over = if comp 0= else 2drop drop false then"
+     " ;"
+     
+     // slw_dt_unit ( par ph -- str len )
+     // encodes the first reg address with the parent's encode-unit,
+     // as package-to-path does, or returns 0 0 if there is none
+     " : slw_dt_unit { par ph ; regAddr regLen addrCells }"
+     "   0 0 par if \" reg\" ph get-package-property 0= if"
+     "     -> regLen -> regAddr"
+     "     \" #address-cells\" par get-package-property"
+     "     if 2 else drop l@ then -> addrCells"
+     "     regLen addrCells 4 * >= if"
+     "       \" encode-unit\" par find-method if"
+     "         >r 2drop"
+     "         addrCells 0 ?do regAddr addrCells 1- i - 4 * + l@ loop"
+     "         r> execute"
+     "       then"
+     "     then"
+     "   then then"
+     " ;"
+     
+     // slw_dt_node ( par ph -- )
+     " : slw_dt_node { par ph ; node props kids val }"
+     "   dtAddr -> node node 8 + to dtAddr"
+     
+     "   \" AAPL,phandle\" slw_dt_name 2drop"
+     "   4 dtAddr 20 + l! ph dtAddr 24 + l! dtAddr 28 + to dtAddr"
+     "   1 -> props"
+     
+     "   par ph slw_dt_unit dup if"
+     "     \" AAPL,unit-string\" slw_dt_name 2drop"
+     "     dup dtAddr 20 + l!"
+     "     dup >r dtAddr 24 + swap move 0 dtAddr 24 + r@ + c!"
+     "     dtAddr 24 + r> 3 + -4 and + to dtAddr"
+     "     props 1+ -> props"
+     "   else 2drop then"
+     
+     "   0 0 begin ph next-property while"
+     "     slw_dt_name"
+     "     2dup ph get-package-property if 0 0 then"
+     "     dtAddr 24 + -> val slw_dt_value"
+     "     ph dtMMPH = if 2dup slw_dt_mm? if val to dtMMAddr then then"
+     "     props 1+ -> props"
+     "   repeat"
+     
+     "   ph child begin dup while"
+     "     ph over recurse kids 1+ -> kids peer"
+     "   repeat drop"
+     "   props node l! kids node 4 + l!"
+     " ;"
+     
+     // slw_flatten ( mmph addr ph -- size mmaddr )
+     " : slw_flatten"
+     "   >r dup >r to dtAddr to dtMMPH 0 to dtMMAddr"
+     "   r> 0 r> slw_dt_node dtAddr swap - dtMMAddr"
+     " ;"
+     );
+}
+
+
 long FlatenNode(CICell ph, long nodeAddr, long *nodeSize)
 {
   DTNodePtr node;
@@ -174,8 +314,8 @@ long FlatenNode(CICell ph, long nodeAddr, long *nodeSize)
 long FlatenProps(CICell ph, long propAddr, long *propSize, long *numProps)
 {
   DTPropertyPtr prop;
-  long          ret, cnt, curAddr, valueAddr, valueSize, nProps;
-  char          *prevName;
+  long          ret, curAddr, valueAddr, valueSize, nProps;
+  char          *prevName, *unitString;
   
   curAddr = propAddr;
   prevName = "";
@@ -191,21 +331,15 @@ long FlatenProps(CICell ph, long propAddr, long *propSize, long *numProps)
   nProps++;
   
   // Make the AAPL,unit-string property.
-  ret = PackageToPath(ph, gTempStr, 4095);
-  if (ret > 0) {
-    cnt = ret - 1;
-    while (cnt && (gTempStr[cnt - 1] != '@') &&
-	   (gTempStr[cnt - 1] != '/')) cnt--;
-    
-    if (gTempStr[cnt - 1] == '@') {
-      prop = (DTPropertyPtr)curAddr;
-      valueAddr = curAddr + sizeof(DTProperty);
-      strcpy(prop->name, "AAPL,unit-string");
-      strcpy((char *)valueAddr, &gTempStr[cnt]);
-      prop->length = ret - cnt;
-      curAddr = valueAddr + ((prop->length + 3) & ~3);
-      nProps++;
-    }
+  ret = GetUnitString(ph, &unitString);
+  if (ret != 0) {
+    prop = (DTPropertyPtr)curAddr;
+    valueAddr = curAddr + sizeof(DTProperty);
+    strcpy(prop->name, "AAPL,unit-string");
+    strcpy((char *)valueAddr, unitString);
+    prop->length = ret;
+    curAddr = valueAddr + ((prop->length + 3) & ~3);
+    nProps++;
   }
   
   while (1) {
@@ -237,3 +371,26 @@ long FlatenProps(CICell ph, long propAddr, long *propSize, long *numProps)
   
   return 0;
 }
+
+
+// Return the length of the unit address in the path of ph and point
+// unitString at it, or return 0 if the path has no unit address.
+
+static long GetUnitString(CICell ph, char **unitString)
+{
+  long ret, cnt;
+  
+  ret = PackageToPath(ph, gTempStr, 4095);
+  if (ret <= 0) return 0;
+  
+  cnt = ret - 1;
+  while (cnt && (gTempStr[cnt - 1] != '@') &&
+	 (gTempStr[cnt - 1] != '/')) cnt--;
+  
+  if (gTempStr[cnt - 1] != '@') return 0;
+  
+  *unitString = &gTempStr[cnt];
+  
+  return ret - cnt;
+}
+
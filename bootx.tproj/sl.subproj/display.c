@@ -164,6 +164,8 @@ long DrawSplashScreen(long stage)
 	       x, y,
 	       kNetBootWidth, kNetBootHeight,
 	       kNetBootFrames, kNetBootFPS, pixelSize, 0);
+      if (display->address != 0)
+	SpinInitFrameBuffer((char *)display->address, display->linebytes);
     }
     break;
     
@@ -45,9 +45,15 @@ struct Module {
   char          *plistAddr;
   long          plistLength;
   char          *driverPath;
+  char          *bundleID;
+  struct Module *hashNext;
+  struct Module *workNext;
 };
 typedef struct Module Module, *ModulePtr;
 
+// Modules are indexed by CFBundleIdentifier.
+#define kModuleHashSize (256)
+
 struct DriverInfo {
   char *plistAddr;
   long plistLength;
@@ -71,27 +77,99 @@ struct DriversPackage {
 };
 typedef struct DriversPackage DriversPackage;
 
+// A plist index holds the parsed Info.plists of the kexts in the
+// Extensions folder, as written by plist-index.  Like the mkext it
+// is only used if its date is one more than the folder's.
+#define kPListIndexSignature1 'PLIX'
+#define kPListIndexSignature2 'MOSX'
+#define kPListIndexVersion    (1)
+
+struct PListIndex {
+  unsigned long signature1;
+  unsigned long signature2;
+  unsigned long length;
+  unsigned long adler32;
+  unsigned long version;
+  unsigned long numKexts;
+  unsigned long numTags;
+  unsigned long reserved;
+};
+typedef struct PListIndex PListIndex, *PListIndexPtr;
+
+// The header is followed by the kexts, then the tags, then the
+// strings and plists.  Offsets are from the start of the index, and
+// the tags are Tags with offsets in place of the pointers.
+struct PListIndexKext {
+  unsigned long dict;		// offset of the Info.plist's dict tag
+  unsigned long bundleID;	// offset of CFBundleIdentifier or 0
+  unsigned long required;	// offset of OSBundleRequired or 0
+  unsigned long driverPath;	// offset of the path below Extensions
+  unsigned long plistAddr;	// offset of the Info.plist text
+  unsigned long plistLength;	// not counting the terminator
+};
+typedef struct PListIndexKext PListIndexKext, *PListIndexKextPtr;
+
 enum {
   kCFBundleType2,
   kCFBundleType3
 };
 
+// Directory entries read per GetDirEntries call, for the Extensions
+// folder and for one level of PlugIns folders.
+#define kDriverDirEntries (32)
+
+// The Info.plists for a batch of kexts are read ahead into the upper
+// half of the load area before any of them is parsed, a quarter for
+// the Extensions folder and a quarter for PlugIns folders.
+#define kDriverPListAddr  (kLoadAddr + kLoadSize / 2)
+#define kDriverPListSize  (kLoadSize / 4)
+
+// A plist index is read into the upper half instead.
+#define kDriverIndexAddr  (kLoadAddr + kLoadSize / 2)
+#define kDriverIndexSize  (kLoadSize / 2)
+
+// Tags and symbols for the Info.plists are parsed into the second
+// quarter of the load area. Only the dicts of modules that will load
+// are kept once matching is done; the rest is dropped with the arena.
+#define kDriverTagArenaAddr (kLoadAddr + kLoadSize / 4)
+#define kDriverTagArenaSize (kLoadSize / 4)
+
+struct DriverPList {
+  long bundleType;
+  char *plistAddr;	// 0 if the plist was not read ahead
+  long plistLength;
+};
+typedef struct DriverPList DriverPList, *DriverPListPtr;
+
 static long FileLoadDrivers(char *dirSpec, long plugin);
 static long NetLoadDrivers(char *dirSpec);
 static long LoadDriverMKext(char *fileSpec);
-static long LoadDriverPList(char *dirSpec, char *name, long bundleType);
+static long LoadDriverIndex(char *dirSpec);
+static long ReadDriverPLists(char *dirSpec, DirEntryPtr entries,
+			    DriverPListPtr plists, long numEntries,
+			    char *plistAddr, long plistSize);
+static long LoadDriverPList(char *dirSpec, char *name, long bundleType,
+			    char *plistAddr, long plistLength);
 static long LoadMatchedModules(void);
+static long KeepMatchedModules(void);
 static long MatchPersonalities(void);
 static long MatchLibraries(void);
 static ModulePtr FindModule(char *name);
+static void AddModule(ModulePtr module);
+static void AddPersonalities(TagPtr personalities);
+static long ModuleHash(char *name);
 static long XML2Module(char *buffer, ModulePtr *module, TagPtr *personalities);
 
 static ModulePtr gModuleHead, gModuleTail;
+static ModulePtr gModuleHash[kModuleHashSize];
 static TagPtr    gPersonalityHead, gPersonalityTail;
+static char      *gDriverIndex;
 static char      gDriverSpec[4096];
 static char      gFileSpec[4096];
 static char      gTempSpec[4096];
 static char      gFileName[4096];
+static DirEntry  gDriverDirEntries[2][kDriverDirEntries];
+static DriverPList gDriverPLists[2][kDriverDirEntries];
 
 // Public Functions
 
@@ -100,16 +178,23 @@ long LoadDrivers(char *dirSpec)
   if (gBootFileType == kNetworkDeviceType) {
     NetLoadDrivers(dirSpec);
   } else if (gBootFileType == kBlockDeviceType) {
+    InitTagArena((char *)kDriverTagArenaAddr, kDriverTagArenaSize);
     FileLoadDrivers(dirSpec, 0);
   } else {
     return 0;
   }
   
+  TimelineBegin("MatchModules", 0);
   MatchPersonalities();
   
   MatchLibraries();
   
+  KeepMatchedModules();
+  TimelineEnd("MatchModules", 0);
+  
+  TimelineBegin("LoadMatchedModules", 0);
   LoadMatchedModules();
+  TimelineEnd("LoadMatchedModules", 0);
   
   return 0;
 }
@@ -118,8 +203,10 @@ long LoadDrivers(char *dirSpec)
 
 static long FileLoadDrivers(char *dirSpec, long plugin)
 {
-  long ret, length, index, flags, time, time2, bundleType;
-  char *name;
+  long           ret, index, flags, time, time2, bundleType;
+  long           numEntries, cnt;
+  DirEntryPtr    entries = gDriverDirEntries[plugin ? 1 : 0];
+  DriverPListPtr plists = gDriverPLists[plugin ? 1 : 0];
   
   if (!plugin) {
     ret = GetFileInfo(dirSpec, "Extensions.mkext", &flags, &time);
@@ -138,6 +225,11 @@ static long FileLoadDrivers(char *dirSpec, long plugin)
 	}
     }
     
+    TimelineBegin("LoadDriverIndex", 0);
+    ret = LoadDriverIndex(dirSpec);
+    TimelineEnd("LoadDriverIndex", ret);
+    if (ret == 0) return 0;
+    
     strcat(dirSpec, "Extensions");
   }
   
@@ -145,34 +237,38 @@ static long FileLoadDrivers(char *dirSpec, long plugin)
   
   index = 0;
   while (1) {
-    ret = GetDirEntry(dirSpec, &index, &name, &flags, &time);
-    if (ret == -1) break;
-
-    // Make sure this is a directory.
-    if ((flags & kFileTypeMask ) != kFileTypeDirectory) continue;
-    
-    // Make sure this is a kext.
-    length = strlen(name);
-    if (strcmp(name + length - 5, ".kext")) continue;
-    
-    // Save the file name.
-    strcpy(gFileName, name);
-    
-    // Determine the bundle type.
-    sprintf(gTempSpec, "%s\\%s", dirSpec, gFileName);
-    ret = GetFileInfo(gTempSpec, "Contents", &flags, &time);
-    if (ret == 0) bundleType = kCFBundleType2;
-    else bundleType = kCFBundleType3;
-    
-    if (!plugin) {
-      sprintf(gDriverSpec, "%s\\%s\\%sPlugIns", dirSpec, gFileName,
-	      (bundleType == kCFBundleType2) ? "Contents\\" : "");
-    }
+    numEntries = GetDirEntries(dirSpec, &index, entries, kDriverDirEntries);
+    if (numEntries <= 0) break;
     
-    ret = LoadDriverPList(dirSpec, gFileName, bundleType);
+    // Read all of the batch's Info.plists, then parse them.
+    TimelineBegin("ReadDriverPLists", numEntries);
+    ReadDriverPLists(dirSpec, entries, plists, numEntries,
+		     (char *)kDriverPListAddr + (plugin ? kDriverPListSize : 0),
+		     kDriverPListSize);
+    TimelineEnd("ReadDriverPLists", numEntries);
     
-    if (!plugin) {
-      ret = FileLoadDrivers(gDriverSpec, 1);
+    for (cnt = 0; cnt < numEntries; cnt++) {
+      // Skip entries that are not kexts.
+      if (plists[cnt].bundleType == -1) continue;
+      
+      // Save the file name.
+      strcpy(gFileName, entries[cnt].name);
+      bundleType = plists[cnt].bundleType;
+      
+      if (!plugin) {
+	sprintf(gDriverSpec, "%s\\%s\\%sPlugIns", dirSpec, gFileName,
+		(bundleType == kCFBundleType2) ? "Contents\\" : "");
+      }
+      
+      // Each kext's load is named for the kext.
+      TimelineBegin(gFileName, plists[cnt].plistLength);
+      ret = LoadDriverPList(dirSpec, gFileName, bundleType,
+			    plists[cnt].plistAddr, plists[cnt].plistLength);
+      TimelineEnd(gFileName, ret);
+      
+      if (!plugin) {
+	ret = FileLoadDrivers(gDriverSpec, 1);
+      }
     }
   }
   
@@ -209,20 +305,24 @@ static long NetLoadDrivers(char *dirSpec)
 
 static long LoadDriverMKext(char *fileSpec)
 {
-  unsigned long  driversAddr, driversLength, length;
+  unsigned long  driversAddr, driversLength, length, adler32;
   char           segName[32];
   DriversPackage *package;
   
   // Load the MKext.
+  TimelineBegin("LoadMKext", 0);
   length = LoadThinFatFile(fileSpec, (void **)&package);
+  TimelineEnd("LoadMKext", length);
   if (length == -1) return -1;
   
   // Verify the MKext.
   if ((package->signature1 != kDriverPackageSignature1) ||
       (package->signature2 != kDriverPackageSignature2)) return -1;
   if (package->length > kLoadSize) return -1;
-  if (package->adler32 != Adler32((char *)&package->version,
-				  package->length - 0x10)) return -1;
+  TimelineBegin("VerifyMKext", package->length);
+  adler32 = Adler32((char *)&package->version, package->length - 0x10);
+  TimelineEnd("VerifyMKext", package->adler32 == adler32);
+  if (package->adler32 != adler32) return -1;
   
   // Make space for the MKext.
   driversLength = package->length;
@@ -239,7 +339,157 @@ static long LoadDriverMKext(char *fileSpec)
 }
 
 
-static long LoadDriverPList(char *dirSpec, char *name, long bundleType)
+static long LoadDriverIndex(char *dirSpec)
+{
+  long              ret, flags, time, time2, length, cnt;
+  unsigned long     tagsStart, tagsEnd;
+  char              *base, *required;
+  PListIndexPtr     index;
+  PListIndexKextPtr kexts, kext;
+  TagPtr            tags;
+  ModulePtr         module;
+  
+  ret = GetFileInfo(dirSpec, "Extensions.plistindex", &flags, &time);
+  if ((ret != 0) || ((flags & kFileTypeMask) != kFileTypeFlat)) return -1;
+  
+  // Only use the index if it was made from the folder as it is now.
+  ret = GetFileInfo(dirSpec, "Extensions", &flags, &time2);
+  if ((ret != 0) || ((flags & kFileTypeMask) != kFileTypeDirectory)) {
+    return -1;
+  }
+  if (time != (time2 + 1)) {
+    printf("plist index timestamp isn't quite right (delta: %d); "
+	   "ignoring...\n", time2 - time);
+    return -1;
+  }
+  
+  sprintf(gDriverSpec, "%sExtensions.plistindex", dirSpec);
+  printf("FileLoadDrivers: Loading from [%s]\n", gDriverSpec);
+  
+  // An index that fills the area may have been cut short.
+  base = (char *)kDriverIndexAddr;
+  length = ReadFileAt(gDriverSpec, base, 0, kDriverIndexSize);
+  if ((length == -1) || (length == kDriverIndexSize)) return -1;
+  
+  // Verify the index.
+  index = (PListIndexPtr)base;
+  if (length < sizeof(PListIndex)) return -1;
+  if ((index->signature1 != kPListIndexSignature1) ||
+      (index->signature2 != kPListIndexSignature2) ||
+      (index->version != kPListIndexVersion) ||
+      (index->length != length)) return -1;
+  if (index->adler32 != Adler32((char *)&index->version,
+				length - 0x10)) return -1;
+  
+  if ((index->numKexts > length) || (index->numTags > length)) return -1;
+  kexts = (PListIndexKextPtr)(index + 1);
+  tags = (TagPtr)(kexts + index->numKexts);
+  tagsStart = (char *)tags - base;
+  tagsEnd = (char *)(tags + index->numTags) - base;
+  if (tagsEnd > length) return -1;
+  
+  for (cnt = 0; cnt < index->numKexts; cnt++) {
+    kext = kexts + cnt;
+    if ((kext->dict < tagsStart) || (kext->dict >= tagsEnd) ||
+	(kext->bundleID >= length) || (kext->required >= length) ||
+	(kext->driverPath >= length) || (kext->plistAddr >= length) ||
+	(kext->plistLength >= (length - kext->plistAddr))) return -1;
+  }
+  
+  if (RelocateTags(base, length, tags, index->numTags) == -1) return -1;
+  
+  for (cnt = 0; cnt < index->numKexts; cnt++) {
+    kext = kexts + cnt;
+    
+    // Use the same test as XML2Module.
+    required = (kext->required != 0) ? (base + kext->required) : 0;
+    if ((required == 0) || !strcmp(required, "Safe Boot")) continue;
+    
+    module = AllocateBootXMemory(sizeof(Module));
+    if (module == 0) break;
+    
+    sprintf(gFileSpec, "%sExtensions%s", dirSpec, base + kext->driverPath);
+    module->driverPath = AllocateBootXMemory(strlen(gFileSpec) + 1);
+    if (module->driverPath == 0) break;
+    strcpy(module->driverPath, gFileSpec);
+    
+    // The plists of the modules that load are copied by
+    // KeepMatchedModules.
+    module->nextModule = 0;
+    module->willLoad = 1;
+    module->dict = (TagPtr)(base + kext->dict);
+    module->plistAddr = base + kext->plistAddr;
+    module->plistLength = kext->plistLength + 1;
+    module->bundleID = (kext->bundleID != 0) ? (base + kext->bundleID) : 0;
+    module->hashNext = 0;
+    module->workNext = 0;
+    
+    AddModule(module);
+    
+    AddPersonalities(GetProperty(module->dict, kPropIOKitPersonalities));
+  }
+  
+  gDriverIndex = base;
+  
+  return 0;
+}
+
+
+static long ReadDriverPLists(char *dirSpec, DirEntryPtr entries,
+			    DriverPListPtr plists, long numEntries,
+			    char *plistAddr, long plistSize)
+{
+  long ret, cnt, length, flags, time;
+  char *name;
+  
+  for (cnt = 0; cnt < numEntries; cnt++) {
+    name = entries[cnt].name;
+    plists[cnt].bundleType = -1;
+    plists[cnt].plistAddr = 0;
+    plists[cnt].plistLength = 0;
+    
+    // Make sure this is a directory.
+    if ((entries[cnt].flags & kFileTypeMask) != kFileTypeDirectory) continue;
+    
+    // Make sure this is a kext.
+    length = strlen(name);
+    if ((length < 5) || strcmp(name + length - 5, ".kext")) continue;
+    
+    // Determine the bundle type.
+    sprintf(gTempSpec, "%s\\%s", dirSpec, name);
+    ret = GetFileInfo(gTempSpec, "Contents", &flags, &time);
+    if (ret == 0) plists[cnt].bundleType = kCFBundleType2;
+    else plists[cnt].bundleType = kCFBundleType3;
+    
+    // Once the area is full the rest are loaded when they are parsed.
+    if (plistSize <= 1) continue;
+    
+    sprintf(gTempSpec, "%s\\%s\\%sInfo.plist", dirSpec, name,
+	    (plists[cnt].bundleType == kCFBundleType2) ? "Contents\\" : "");
+    
+    // Leave room for the terminator.  A plist that fills the rest
+    // of the area may have been cut short, so it is loaded later.
+    length = ReadFileAt(gTempSpec, plistAddr, 0, plistSize - 1);
+    if (length == -1) continue;
+    if (length == (plistSize - 1)) {
+      plistSize = 0;
+      continue;
+    }
+    
+    plistAddr[length] = '\0';
+    plists[cnt].plistAddr = plistAddr;
+    plists[cnt].plistLength = length;
+    
+    plistAddr += length + 1;
+    plistSize -= length + 1;
+  }
+  
+  return 0;
+}
+
+
+static long LoadDriverPList(char *dirSpec, char *name, long bundleType,
+			    char *plistAddr, long plistLength)
 {
   long      length, ret, driverPathLength;
   char      *buffer;
@@ -258,15 +508,21 @@ static long LoadDriverPList(char *dirSpec, char *name, long bundleType)
   if (tmpDriverPath == 0) return -1;
   strcpy(tmpDriverPath, gFileSpec);
   
-  // Construct the file spec.
-  sprintf(gFileSpec, "%s\\%s\\%sInfo.plist", dirSpec, name,
-	  (bundleType == kCFBundleType2) ? "Contents\\" : "");
-  
-  length = LoadFile(gFileSpec);
-  *((char*)kLoadAddr + length) = '\0';  // terminate for parser safety
-  if (length == -1) {
-    free(tmpDriverPath);
-    return -1;
+  // Load the plist unless it was read ahead.
+  if (plistAddr == 0) {
+    // Construct the file spec.
+    sprintf(gFileSpec, "%s\\%s\\%sInfo.plist", dirSpec, name,
+	    (bundleType == kCFBundleType2) ? "Contents\\" : "");
+    
+    length = LoadFile(gFileSpec);
+    if (length == -1) {
+      free(tmpDriverPath);
+      return -1;
+    }
+    plistAddr = (char *)kLoadAddr;
+    plistAddr[length] = '\0';  // terminate for parser safety
+  } else {
+    length = plistLength;
   }
   
   buffer = malloc(length + 1);
@@ -274,7 +530,7 @@ static long LoadDriverPList(char *dirSpec, char *name, long bundleType)
     free(tmpDriverPath);
     return -1;
   }
-  strncpy(buffer, (char *)kLoadAddr, length);
+  strncpy(buffer, plistAddr, length);
   
   ret = XML2Module(buffer, &module, &personalities);
   free(buffer);
@@ -298,23 +554,14 @@ static long LoadDriverPList(char *dirSpec, char *name, long bundleType)
   free(tmpDriverPath);
   
   // Add the origin plist to the module.
-  strncpy(module->plistAddr, (char *)kLoadAddr, length);
+  strncpy(module->plistAddr, plistAddr, length);
   module->plistLength = length + 1;
   
   // Add the module to the end of the module list.
-  if (gModuleHead == 0) gModuleHead = module;
-  else gModuleTail->nextModule = module;
-  gModuleTail = module;
+  AddModule(module);
   
   // Add the extracted personalities to the list.
-  if (personalities) personalities = personalities->tag;
-  while (personalities != 0) {
-    if (gPersonalityHead == 0) gPersonalityHead = personalities->tag;
-    else gPersonalityTail->tagNext = personalities->tag;
-    gPersonalityTail = personalities->tag;
-    
-    personalities = personalities->tagNext;
-  }
+  AddPersonalities(personalities);
   
   return 0;
 }
@@ -375,6 +622,52 @@ static long LoadMatchedModules(void)
 }
 
 
+static long KeepMatchedModules(void)
+{
+  TagPtr    prop;
+  ModulePtr module;
+  char      *plistAddr;
+  
+  // Copy the dicts of the modules that will load out of the arena,
+  // and their plists out of the plist index if there is one.
+  for (module = gModuleHead; module != 0; module = module->nextModule) {
+    if (module->willLoad && (gDriverIndex != 0)) {
+      plistAddr = AllocateBootXMemory(module->plistLength);
+      if (plistAddr != 0) {
+	memcpy(plistAddr, module->plistAddr, module->plistLength);
+      } else module->willLoad = 0;
+      module->plistAddr = plistAddr;
+    }
+    
+    if (module->willLoad) {
+      module->dict = KeepTag(module->dict);
+      if (module->dict != 0) {
+	prop = GetProperty(module->dict, kPropCFBundleIdentifier);
+	module->bundleID = (prop != 0) ? prop->string : 0;
+      } else {
+	printf("KeepMatchedModules: out of memory for [%s]\n",
+	       module->driverPath);
+	module->willLoad = 0;
+	module->bundleID = 0;
+      }
+    } else {
+      module->dict = 0;
+      module->bundleID = 0;
+    }
+  }
+  
+  // The personalities and the module index point into the arena.
+  gPersonalityHead = 0;
+  gPersonalityTail = 0;
+  bzero(gModuleHash, sizeof(gModuleHash));
+  
+  FreeTagArena();
+  gDriverIndex = 0;
+  
+  return 0;
+}
+
+
 static long MatchPersonalities(void)
 {
   TagPtr    persionality;
@@ -420,37 +713,37 @@ static long MatchPersonalities(void)
 
 static long MatchLibraries(void)
 {
-  TagPtr        prop, prop2;
-  ModulePtr     module, module2;
-  long          done;
-  
-  do {
-    done = 1;
-    module = gModuleHead;
-    while (module != 0) {
-      if (module->willLoad == 1) {
-	prop = GetProperty(module->dict, kPropOSBundleLibraries);
-	if (prop != 0) {
-	  prop = prop->tag;
-	  while (prop != 0) {
-	    module2 = gModuleHead;
-	    while (module2 != 0) {
-	      prop2 = GetProperty(module2->dict, kPropCFBundleIdentifier);
-	      if ((prop2 != 0) && (!strcmp(prop->string, prop2->string))) {
-		if (module2->willLoad == 0) module2->willLoad = 1;
-		break;
-	      }
-	      module2 = module2->nextModule;
-	    }
-	    prop = prop->tagNext;
-	  }
+  TagPtr        prop;
+  ModulePtr     module, module2, workList = 0;
+  
+  // Start with the modules that are already marked for loading.
+  for (module = gModuleHead; module != 0; module = module->nextModule) {
+    if (module->willLoad == 1) {
+      module->workNext = workList;
+      workList = module;
+    }
+  }
+  
+  // Mark each module's libraries, adding newly marked ones to the list.
+  while (workList != 0) {
+    module = workList;
+    workList = module->workNext;
+    
+    prop = GetProperty(module->dict, kPropOSBundleLibraries);
+    if (prop != 0) {
+      prop = prop->tag;
+      while (prop != 0) {
+	module2 = FindModule(prop->string);
+	if ((module2 != 0) && (module2->willLoad == 0)) {
+	  module2->willLoad = 1;
+	  module2->workNext = workList;
+	  workList = module2;
 	}
-	module->willLoad = 2;
-	done = 0;
+	prop = prop->tagNext;
       }
-      module = module->nextModule;
     }
-  } while (!done);
+    module->willLoad = 2;
+  }
   
   return 0;
 }
@@ -459,23 +752,62 @@ static long MatchLibraries(void)
 static ModulePtr FindModule(char *name)
 {
   ModulePtr module;
-  TagPtr    prop;
   
-  module = gModuleHead;
+  module = gModuleHash[ModuleHash(name)];
   
   while (module != 0) {
-    prop = GetProperty(module->dict, kPropCFBundleIdentifier);
-    if ((prop != 0) && !strcmp(name, prop->string)) break;
-    module = module->nextModule;
+    if (!strcmp(name, module->bundleID)) break;
+    module = module->hashNext;
   }
   
   return module;
 }
 
+
+static void AddModule(ModulePtr module)
+{
+  long hash;
+  
+  if (gModuleHead == 0) gModuleHead = module;
+  else gModuleTail->nextModule = module;
+  gModuleTail = module;
+  
+  // Only the first module with a given identifier can be found,
+  // so later duplicates are left out of the index.
+  if ((module->bundleID == 0) || (FindModule(module->bundleID) != 0)) return;
+  
+  hash = ModuleHash(module->bundleID);
+  module->hashNext = gModuleHash[hash];
+  gModuleHash[hash] = module;
+}
+
+
+static void AddPersonalities(TagPtr personalities)
+{
+  if (personalities) personalities = personalities->tag;
+  while (personalities != 0) {
+    if (gPersonalityHead == 0) gPersonalityHead = personalities->tag;
+    else gPersonalityTail->tagNext = personalities->tag;
+    gPersonalityTail = personalities->tag;
+    
+    personalities = personalities->tagNext;
+  }
+}
+
+
+static long ModuleHash(char *name)
+{
+  unsigned long hash = 0;
+  
+  while (*name != '\0') hash = hash * 31 + *name++;
+  
+  return hash % kModuleHashSize;
+}
+
 /* turn buffer of XML into a ModulePtr for driver analysis */
 static long XML2Module(char *buffer, ModulePtr *module, TagPtr *personalities)
 {
-  TagPtr         moduleDict = NULL, required;
+  TagPtr         moduleDict = NULL, required, prop;
   ModulePtr      tmpModule;
 
   if(ParseXML(buffer, &moduleDict) < 0)
@@ -495,6 +827,10 @@ static long XML2Module(char *buffer, ModulePtr *module, TagPtr *personalities)
   }
   tmpModule->dict = moduleDict;
   
+  prop = GetProperty(moduleDict, kPropCFBundleIdentifier);
+  if (prop != 0) tmpModule->bundleID = prop->string;
+  else tmpModule->bundleID = 0;
+  
   // For now, load any module that has OSBundleRequired != "Safe Boot".
   tmpModule->willLoad = 1;
   
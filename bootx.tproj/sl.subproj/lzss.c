@@ -45,24 +45,106 @@
 #define THRESHOLD 2     /* encode string into position and length
                            if match_length is greater than this */
 #define NIL       N     /* index for root of binary search trees */
+#define ADLER_CHUNK 4096 /* bytes of output checksummed at a time */
+
+static u_int32_t decode(lzss_stream *stream, u_int8_t *src,
+                        u_int32_t srclen, int last);
+static u_int8_t *copy_match(u_int8_t *dst, u_int8_t *dststart, int i, int j);
 
 int
 decompress_lzss(u_int8_t *dst, u_int8_t *src, u_int32_t srclen)
 {
-    /* ring buffer of size N, with extra F-1 bytes to aid string comparison */
-    u_int8_t text_buf[N + F - 1];
-    u_int8_t *dststart = dst;
+    lzss_stream stream;
+    
+    decompress_lzss_start(&stream, dst, 0);
+    decode(&stream, src, srclen, 1);
+    return stream.dst - dst;
+}
+
+/* also returns the Adler-32 of the output */
+int
+decompress_lzss_adler32(u_int8_t *dst, u_int8_t *src, u_int32_t srclen,
+                        u_int32_t *adler32)
+{
+    lzss_stream stream;
+    
+    decompress_lzss_start(&stream, dst, 1);
+    decode(&stream, src, srclen, 1);
+    *adler32 = stream.adler32;
+    return stream.dst - dst;
+}
+
+/*
+ * The input can also be fed in pieces as it is read.  Each call
+ * decodes the whole groups in src and returns how many bytes it
+ * used; the rest (less than a group) must be passed again at the
+ * front of the next piece.  The last piece is decoded to its end.
+ */
+void
+decompress_lzss_start(lzss_stream *stream, u_int8_t *dst, int checksum)
+{
+    stream->dststart = dst;
+    stream->dst = dst;
+    stream->checksum = checksum;
+    stream->adler32 = 1;
+}
+
+u_int32_t
+decompress_lzss_chunk(lzss_stream *stream, u_int8_t *src, u_int32_t srclen,
+                      int last)
+{
+    return decode(stream, src, srclen, last);
+}
+
+/*
+ * The ring buffer is not kept.  Byte t of the output went into ring
+ * position (N - F + t) & (N - 1), so a match at position i is a copy
+ * from earlier in the output, or from the spaces the ring started
+ * with if it reaches back before the first byte.
+ */
+static u_int32_t
+decode(lzss_stream *stream, u_int8_t *src, u_int32_t srclen, int last)
+{
+    u_int8_t *dststart = stream->dststart;
+    u_int8_t *dst = stream->dst;
+    u_int8_t *srcstart = src;
     u_int8_t *srcend = src + srclen;
-    int  i, j, k, r, c;
+    u_int8_t *sumstart = dst;
+    int  i, j, c, bit;
     unsigned int flags;
     
-    dst = dststart;
-    srcend = src + srclen;
-    for (i = 0; i < N - F; i++)
-        text_buf[i] = ' ';
-    r = N - F;
+    /* while a whole group of eight is left, without bounds checks */
+    while (srcend - src >= 1 + 8 * 2) {
+        if (stream->checksum && (dst - sumstart >= ADLER_CHUNK)) {
+            stream->adler32 = UpdateAdler32(stream->adler32, sumstart,
+                                            dst - sumstart);
+            sumstart = dst;
+        }
+        flags = *src++;
+        if (flags == 0xFF) {
+            /* eight literals in a row */
+            dst[0] = src[0]; dst[1] = src[1];
+            dst[2] = src[2]; dst[3] = src[3];
+            dst[4] = src[4]; dst[5] = src[5];
+            dst[6] = src[6]; dst[7] = src[7];
+            dst += 8;
+            src += 8;
+            continue;
+        }
+        for (bit = 0; bit < 8; bit++, flags >>= 1) {
+            if (flags & 1) {
+                *dst++ = *src++;
+            } else {
+                i = *src++;
+                j = *src++;
+                dst = copy_match(dst, dststart, i | ((j & 0xF0) << 4),
+                                 (j & 0x0F) + THRESHOLD + 1);
+            }
+        }
+    }
+    
     flags = 0;
-    for ( ; ; ) {
+    if (last) for ( ; ; ) {
         if (((flags >>= 1) & 0x100) == 0) {
             if (src < srcend) c = *src++; else break;
             flags = c | 0xFF00;  /* uses higher byte cleverly */
@@ -70,21 +152,51 @@ decompress_lzss(u_int8_t *dst, u_int8_t *src, u_int32_t srclen)
         if (flags & 1) {
             if (src < srcend) c = *src++; else break;
             *dst++ = c;
-            text_buf[r++] = c;
-            r &= (N - 1);
         } else {
             if (src < srcend) i = *src++; else break;
             if (src < srcend) j = *src++; else break;
-            i |= ((j & 0xF0) << 4);
-            j  =  (j & 0x0F) + THRESHOLD;
-            for (k = 0; k <= j; k++) {
-                c = text_buf[(i + k) & (N - 1)];
-                *dst++ = c;
-                text_buf[r++] = c;
-                r &= (N - 1);
-            }
+            dst = copy_match(dst, dststart, i | ((j & 0xF0) << 4),
+                             (j & 0x0F) + THRESHOLD + 1);
         }
     }
     
-    return dst - dststart;
+    if (stream->checksum)
+        stream->adler32 = UpdateAdler32(stream->adler32, sumstart,
+                                        dst - sumstart);
+    
+    stream->dst = dst;
+    return src - srcstart;
+}
+
+/* copy j bytes from ring position i */
+static u_int8_t *
+copy_match(u_int8_t *dst, u_int8_t *dststart, int i, int j)
+{
+    u_int8_t *ref;
+    int  dist;
+    
+    /* a match at the current position reaches back N bytes */
+    dist = ((dst - dststart) + N - F - i) & (N - 1);
+    if (dist == 0) dist = N;
+    
+    if (dist > (dst - dststart)) {
+        /* only near the start of the output */
+        for ( ; j > 0; j--, dst++) {
+            if (dist > (dst - dststart)) *dst = ' ';
+            else *dst = *(dst - dist);
+        }
+        return dst;
+    }
+    
+    ref = dst - dist;
+    /* Words can be copied when each one has been written before it
+       is read.  The PowerPC handles misaligned word accesses. */
+    if (dist >= 4) {
+        for ( ; j >= 4; j -= 4, dst += 4, ref += 4)
+            *(u_int32_t *)dst = *(u_int32_t *)ref;
+    }
+    for ( ; j > 0; j--)
+        *dst++ = *ref++;
+    
+    return dst;
 }
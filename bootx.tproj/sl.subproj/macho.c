@@ -36,8 +36,15 @@
 static long DecodeSegment(long cmdBase);
 static long DecodeUnixThread(long cmdBase);
 static long DecodeSymbolTable(long cmdBase);
+static long ReadMachO(char *addr, long fileOffset, long size);
+
+// The load commands must fit in the first read of the file
+// for its segments to be read straight into place.
+#define kMachOHeaderSize (0x1000)
 
 static unsigned long gPPCAddress;
+static char          *gMachOFileSpec;
+static unsigned long gMachOFileOffset;
 
 // Public Functions
 
@@ -77,6 +84,65 @@ long ThinFatBinaryMachO(void **binary, unsigned long *length)
   return 0;
 }
 
+// Decode the Mach-O file at fileSpec by reading its header and then
+// each segment directly to its vmaddr, rather than loading the whole
+// file and copying the segments out of it.  Returns -1 if the file is
+// not a thin or fat PPC Mach-O, or if a read fails part way.  Either
+// way the kernel and BootX memory is left as it was, so the caller can
+// load the whole file and decode it instead.
+
+long DecodeMachOFile(char *fileSpec)
+{
+  struct mach_header *mH;
+  void               *binary = (void *)kLoadAddr;
+  unsigned long      offset = 0;
+  long               length, ret, lastKernelAddr, firstBootXAddr;
+  long               symbolTableAddr, symbolTableSize;
+  char               haveKernelCache;
+  
+  length = ReadFileAt(fileSpec, binary, 0, kMachOHeaderSize);
+  if (length < (long)sizeof(struct mach_header)) return -1;
+  
+  // Read the header of the PPC part of a fat file.
+  if (ThinFatBinaryMachO(&binary, 0) == 0) {
+    offset = (unsigned long)binary - kLoadAddr;
+    if (offset == 0) return -1;
+    
+    binary = (void *)kLoadAddr;
+    length = ReadFileAt(fileSpec, binary, offset, kMachOHeaderSize);
+    if (length < (long)sizeof(struct mach_header)) return -1;
+  }
+  
+  mH = (struct mach_header *)binary;
+  if (mH->magic != MH_MAGIC) return -1;
+  if ((sizeof(struct mach_header) + mH->sizeofcmds) > length) return -1;
+  
+  gMachOFileSpec = fileSpec;
+  gMachOFileOffset = offset;
+  
+  lastKernelAddr = gImageLastKernelAddr;
+  firstBootXAddr = gImageFirstBootXAddr;
+  symbolTableAddr = gSymbolTableAddr;
+  symbolTableSize = gSymbolTableSize;
+  haveKernelCache = gHaveKernelCache;
+  
+  ret = DecodeMachO(binary);
+  
+  gMachOFileSpec = 0;
+  
+  // Take back what was allocated before the read failed.  The memory
+  // ranges that were set are set again by the next decode.
+  if (ret == -1) {
+    gImageLastKernelAddr = lastKernelAddr;
+    gImageFirstBootXAddr = firstBootXAddr;
+    gSymbolTableAddr = symbolTableAddr;
+    gSymbolTableSize = symbolTableSize;
+    gHaveKernelCache = haveKernelCache;
+  }
+  
+  return ret;
+}
+
 long DecodeMachO(void *binary)
 {
   struct mach_header *mH;
@@ -148,20 +214,20 @@ static long DecodeSegment(long cmdBase)
 {
   struct segment_command *segCmd;
   char   rangeName[32];
-  char   *vmaddr, *fileaddr;
-  long   vmsize, filesize;
+  char   *vmaddr;
+  long   vmsize, fileoff, filesize;
   
   segCmd = (struct segment_command *)cmdBase;
   
   vmaddr = (char *)segCmd->vmaddr;
   vmsize = segCmd->vmsize;
   
-  fileaddr = (char *)(gPPCAddress + segCmd->fileoff);
+  fileoff = segCmd->fileoff;
   filesize = segCmd->filesize;
   
 #if 0
   printf("segname: %s, vmaddr: %x, vmsize: %x, fileoff: %x, filesize: %x, nsects: %d, flags: %x.\n",
-	 segCmd->segname, vmaddr, vmsize, fileaddr, filesize,
+	 segCmd->segname, vmaddr, vmsize, fileoff, filesize,
 	 segCmd->nsects, segCmd->flags);
 #endif
   
@@ -180,13 +246,15 @@ static long DecodeSegment(long cmdBase)
       (vmsize != 0) && (filesize != 0)) {
     
     // Copy the first part into the save area.
-    bcopy(fileaddr, gVectorSaveAddr,
-	  (filesize <= kVectorSize) ? filesize : kVectorSize);
+    if (ReadMachO(gVectorSaveAddr, fileoff,
+		  (filesize <= kVectorSize) ? filesize : kVectorSize) == -1)
+      return -1;
     
     // Copy the rest into memory.
     if (filesize > kVectorSize)
-      bcopy(fileaddr + kVectorSize, (char *)kVectorSize,
-	    filesize - kVectorSize);
+      if (ReadMachO((char *)kVectorSize, fileoff + kVectorSize,
+		    filesize - kVectorSize) == -1)
+	return -1;
     
     return 0;
   }
@@ -194,7 +262,7 @@ static long DecodeSegment(long cmdBase)
   // It is nothing special, so do the usual. Only copy sections
   // that have a filesize.  Others are handle by the original bzero.
   if (filesize != 0) {
-    bcopy(fileaddr, vmaddr, filesize);
+    if (ReadMachO(vmaddr, fileoff, filesize) == -1) return -1;
   }
   
   // Adjust the last address used by the kernel
@@ -254,8 +322,34 @@ static long DecodeSymbolTable(long cmdBase)
   symTableSave->stroff = tmpAddr + symsSize;
   symTableSave->strsize = symTab->strsize;
   
-  bcopy((char *)(gPPCAddress + symTab->symoff),
-	(char *)tmpAddr, totalSize);
+  return ReadMachO((char *)tmpAddr, symTab->symoff, totalSize);
+}
+
+
+// Copy size bytes from fileOffset in the Mach-O file to addr, either
+// out of the loaded image or straight from the file.  The file is read
+// in pieces no bigger than the file systems will take at once.
+
+static long ReadMachO(char *addr, long fileOffset, long size)
+{
+  long length;
+  
+  if (gMachOFileSpec == 0) {
+    bcopy((char *)(gPPCAddress + fileOffset), addr, size);
+    return 0;
+  }
+  
+  while (size > 0) {
+    length = (size < kLoadSize) ? size : kLoadSize;
+    
+    length = ReadFileAt(gMachOFileSpec, addr,
+			gMachOFileOffset + fileOffset, length);
+    if (length <= 0) return -1;
+    
+    addr += length;
+    fileOffset += length;
+    size -= length;
+  }
   
   return 0;
 }
@@ -34,6 +34,8 @@
 static void Start(void *unused1, void *unused2, ClientInterfacePtr ciPtr);
 static void Main(ClientInterfacePtr ciPtr);
 static long InitEverything(ClientInterfacePtr ciPtr);
+static long LoadKernelCache(void);
+static long CheckKernelHeader(compressed_kernel_header *kernel_header);
 static long DecodeKernel(void *binary);
 static long SetUpBootArgs(void);
 static long CallKernel(void);
@@ -126,12 +128,18 @@ static void Main(ClientInterfacePtr ciPtr)
   long flags, cachetime, kerneltime, exttime = 0;
   void *binary = (void *)kLoadAddr;
   
+  InitTimeline();
+  
+  TimelineBegin("InitEverything", 0);
   ret = InitEverything(ciPtr);
+  TimelineEnd("InitEverything", ret);
   if (ret != 0) Exit();
 
 
   // Get or infer the boot paths.
+  TimelineBegin("GetBootPaths", 0);
   ret = GetBootPaths();
+  TimelineEnd("GetBootPaths", ret);
   if (ret != 0) FailToBoot(1);
   
 #if kFailToBoot
@@ -171,24 +179,35 @@ static void Main(ClientInterfacePtr ciPtr)
     } while (0);
     
     if (trycache) {
-      ret = LoadFile(gBootKernelCacheFile);
-      if (ret != -1) {
-        ret = DecodeKernel(binary);
-        if (ret != -1) break;
-      }
+      TimelineBegin("LoadKernelCache", 0);
+      ret = LoadKernelCache();
+      TimelineEnd("LoadKernelCache", ret);
+      if (ret != -1) break;
+    }
+    
+    // Read the kernel's segments straight into place if possible,
+    // else load the whole file and copy them out of it.
+    TimelineBegin("LoadKernel", 0);
+    ret = DecodeMachOFile(gBootFile);
+    if (ret == -1) {
+      ret = LoadThinFatFile(gBootFile, &binary);
+      if (ret != -1) ret = DecodeKernel(binary);
     }
-    ret = LoadThinFatFile(gBootFile, &binary);
-    if (ret != -1) ret = DecodeKernel(binary);
+    TimelineEnd("LoadKernel", ret);
     if (ret != -1) break;
     
+    TimelineBegin("GetBootPaths", 0);
     ret = GetBootPaths();
+    TimelineEnd("GetBootPaths", ret);
     if (ret != 0) FailToBoot(2);
   }
   
   if (ret != 0) FailToBoot(3);
   
   if (!gHaveKernelCache) {
+    TimelineBegin("LoadDrivers", 0);
     ret = LoadDrivers(gExtensionsSpec);
+    TimelineEnd("LoadDrivers", ret);
     if (ret != 0) FailToBoot(4);
   }
   
@@ -196,6 +215,9 @@ static void Main(ClientInterfacePtr ciPtr)
   DrawSplashScreen(1);
 #endif
   
+  // SetUpBootArgs saves the timeline, so it is ended by the mark
+  // SaveTimeline leaves.
+  TimelineBegin("SetUpBootArgs", 0);
   ret = SetUpBootArgs();
   if (ret != 0) FailToBoot(5);
   
@@ -245,6 +267,9 @@ static long InitEverything(ClientInterfacePtr ciPtr)
   gOFVersion = GetOFVersion();
   if (gOFVersion == 0) return -1;
   
+  // Pick the Adler-32 code for this processor.
+  InitAdler32();
+  
   // Get the address and size cells for the root.
   GetProp(Peer(0), "#address-cells", (char *)&gRootAddrCells, 4);
   GetProp(Peer(0), "#size-cells", (char *)&gRootSizeCells, 4);
@@ -422,29 +447,127 @@ long ThinFatBinary(void **binary, unsigned long *length)
   return ret;
 }
 
+// The compressed kernelcache is read a chunk at a time into the load
+// area and each chunk is decompressed as it arrives, so its size is
+// not limited by kLoadSize.
+#define kKernelCacheChunkSize (0x00100000)
+
+static long LoadKernelCache(void)
+{
+  compressed_kernel_header *kernel_header;
+  lzss_stream stream;
+  char      *buffer = (char *)kLoadAddr, *data;
+  void      *binary;
+  u_int32_t size, adler32;
+  long      ret, length, offset, left, count, used;
+  
+  // The cache is loaded whole if it is not compressed, or if its
+  // file system can not read part of a file, as net and ext2 can not.
+  length = ReadFileAt(gBootKernelCacheFile, buffer, 0, kKernelCacheChunkSize);
+  if (length == -1) {
+    if (LoadFile(gBootKernelCacheFile) == -1) return -1;
+    return DecodeKernel(buffer);
+  }
+  if (length < (long)sizeof(compressed_kernel_header)) return -1;
+  
+  kernel_header = (compressed_kernel_header *)buffer;
+  
+  if (kernel_header->signature != 'comp') {
+    if (LoadFile(gBootKernelCacheFile) == -1) return -1;
+    return DecodeKernel(buffer);
+  }
+  
+  if (CheckKernelHeader(kernel_header) == -1) return -1;
+  
+  // The header is about to be overwritten by the next chunk.
+  size = kernel_header->uncompressed_size;
+  adler32 = kernel_header->adler32;
+  left = kernel_header->compressed_size;
+  
+  binary = AllocateBootXMemory(size);
+  if (binary == 0) return -1;
+  decompress_lzss_start(&stream, binary, 1);
+  
+  data = buffer + sizeof(compressed_kernel_header);
+  length -= sizeof(compressed_kernel_header);
+  offset = sizeof(compressed_kernel_header) + length;
+  if (length > left) length = left;
+  left -= length;
+  
+  // The reads are inside this phase, since they are interleaved.
+  TimelineBegin("DecompressKernelCache", size);
+  while (1) {
+    used = decompress_lzss_chunk(&stream, data, length, left == 0);
+    if (left == 0) break;
+    
+    // Move the partial group down in front of the next chunk.
+    length -= used;
+    bcopy(data + used, buffer, length);
+    data = buffer;
+    
+    count = (left < kKernelCacheChunkSize) ? left : kKernelCacheChunkSize;
+    count = ReadFileAt(gBootKernelCacheFile, buffer + length, offset, count);
+    if (count <= 0) break;
+    
+    offset += count;
+    length += count;
+    left -= count;
+  }
+  TimelineEnd("DecompressKernelCache",
+	      (left == 0) ? (stream.dst - stream.dststart) : -1);
+  
+  ret = 0;
+  if (left != 0) ret = -1;
+  else if ((stream.dst - stream.dststart) != size) {
+    printf("size mismatch from lzss %x\n", stream.dst - stream.dststart);
+    ret = -1;
+  } else if (stream.adler32 != adler32) {
+    printf("adler mismatch\n");
+    ret = -1;
+  }
+  
+  if (ret == -1) {
+    // Give the memory back before the kernel is loaded instead,
+    // unless something has been allocated below it since.
+    if (gImageFirstBootXAddr == (long)binary) gImageFirstBootXAddr += size;
+    return -1;
+  }
+  
+  return DecodeKernel(binary);
+}
+
+static long CheckKernelHeader(compressed_kernel_header *kernel_header)
+{
+  if (kernel_header->compress_type != 'lzss')
+    return -1;
+  if (kernel_header->platform_name[0] && strcmp(gPlatformName, kernel_header->platform_name))
+    return -1;
+  if (kernel_header->root_path[0] && strcmp(gBootFile, kernel_header->root_path))
+    return -1;
+  
+  return 0;
+}
+
 static long DecodeKernel(void *binary)
 {
   long ret;
   compressed_kernel_header *kernel_header = (compressed_kernel_header *)binary;
-  u_int32_t size;
+  u_int32_t size, adler32;
   
   if (kernel_header->signature == 'comp') {
-    if (kernel_header->compress_type != 'lzss')
-      return -1;
-    if (kernel_header->platform_name[0] && strcmp(gPlatformName, kernel_header->platform_name))
-      return -1;
-    if (kernel_header->root_path[0] && strcmp(gBootFile, kernel_header->root_path))
-      return -1;
+    if (CheckKernelHeader(kernel_header) == -1) return -1;
     
     binary = AllocateBootXMemory(kernel_header->uncompressed_size);
     
-    size = decompress_lzss((u_int8_t *) binary, &kernel_header->data[0], kernel_header->compressed_size);
+    // The checksum is taken as the kernel is decompressed.
+    TimelineBegin("DecompressKernel", kernel_header->compressed_size);
+    size = decompress_lzss_adler32((u_int8_t *) binary, &kernel_header->data[0], kernel_header->compressed_size, &adler32);
+    TimelineEnd("DecompressKernel", size);
     if (kernel_header->uncompressed_size != size) {
       printf("size mismatch from lzss %x\n", size);
       return -1;
     }
-    if (kernel_header->adler32 !=
-	Adler32(binary, kernel_header->uncompressed_size)) {
+    if (kernel_header->adler32 != adler32) {
       printf("adler mismatch\n");
       return -1;
     }
@@ -474,6 +597,24 @@ static long SetUpBootArgs(void)
   SetProp(gChosenPH, "BootXCacheHits", (char *)&gCacheHits, 4);
   SetProp(gChosenPH, "BootXCacheMisses", (char *)&gCacheMisses, 4);
   SetProp(gChosenPH, "BootXCacheEvicts", (char *)&gCacheEvicts, 4);
+  SetProp(gChosenPH, "BootXCacheReadAheads", (char *)&gCacheReadAheads, 4);
+  SetProp(gChosenPH, "BootXCacheReadAheadBlocks",
+	  (char *)&gCacheReadAheadBlocks, 4);
+  SetProp(gChosenPH, "BootXCacheReadAheadHits",
+	  (char *)&gCacheReadAheadHits, 4);
+  
+  // Save HFS catalog lookup cache statistics.
+  SetProp(gChosenPH, "BootXCatalogCacheHits", (char *)&gCatalogCacheHits, 4);
+  SetProp(gChosenPH, "BootXCatalogCacheMisses",
+	  (char *)&gCatalogCacheMisses, 4);
+  SetProp(gChosenPH, "BootXCatalogCacheNodeReadsSaved",
+	  (char *)&gCatalogCacheNodeReadsSaved, 4);
+  
+  // Save the client interface call profile.
+  SaveCIProfile();
+  
+  // Save the boot timeline.
+  SaveTimeline();
   
   // Allocate some memory for the BootArgs.
   gBootArgsSize = sizeof(boot_args);
@@ -1227,37 +1368,3 @@ long AllocateMemoryRange(char *rangeName, long start, long length)
   
   return 0;
 }
-
-#define BASE 65521L /* largest prime smaller than 65536 */
-#define NMAX 5000  
-// NMAX (was 5521) the largest n such that 255n(n+1)/2 + (n+1)(BASE-1) <= 2^32-1
-
-#define DO1(buf,i)  {s1 += buf[i]; s2 += s1;}
-#define DO2(buf,i)  DO1(buf,i); DO1(buf,i+1);
-#define DO4(buf,i)  DO2(buf,i); DO2(buf,i+2);
-#define DO8(buf,i)  DO4(buf,i); DO4(buf,i+4);
-#define DO16(buf)   DO8(buf,0); DO8(buf,8);
-
-unsigned long Adler32(unsigned char *buf, long len)
-{
-    unsigned long s1 = 1; // adler & 0xffff;
-    unsigned long s2 = 0; // (adler >> 16) & 0xffff;
-    int k;
-
-    while (len > 0) {
-        k = len < NMAX ? len : NMAX;
-        len -= k;
-        while (k >= 16) {
-            DO16(buf);
-	    buf += 16;
-            k -= 16;
-        }
-        if (k != 0) do {
-            s1 += *buf++;
-	    s2 += s1;
-        } while (--k);
-        s1 %= BASE;
-        s2 %= BASE;
-    }
-    return (s2 << 16) | s1;
-}
@@ -37,13 +37,38 @@
 #define kXMLTagInteger "integer"
 #define kXMLTagData    "data"
 #define kXMLTagDate    "date"
-#define kXMLTagFalse   "false/"
-#define kXMLTagTrue    "true/"
+#define kXMLTagFalse   "false"
+#define kXMLTagTrue    "true"
 #define kXMLTagArray   "array"
 // for back-references used by libkern serializer
 #define kXMLTagReference "reference"
-#define kXMLTagID      "ID="
-#define kXMLTagIDREF   "IDREF="
+#define kXMLTagID      "ID=\""
+#define kXMLTagIDREF   "IDREF=\""
+
+enum {
+  kXMLTokenUnknown = 0,
+  kXMLTokenPList,
+  kXMLTokenDict,
+  kXMLTokenKey,
+  kXMLTokenString,
+  kXMLTokenInteger,
+  kXMLTokenData,
+  kXMLTokenDate,
+  kXMLTokenFalse,
+  kXMLTokenTrue,
+  kXMLTokenArray,
+  kXMLTokenReference
+};
+
+// One tag as read by GetNextTag.
+struct XMLToken {
+  char *name;		// NUL terminated
+  long kind;
+  long end;		// </name>
+  long empty;		// <name/>
+  long id;		// from ID= or IDREF=, 0 if neither
+};
+typedef struct XMLToken XMLToken, *XMLTokenPtr;
 
 static long ParseNextTag(char *buffer, TagPtr *tag);
 static long ParseTagList(char *buffer, TagPtr *tag, long type, long empty);
@@ -53,11 +78,46 @@ static long ParseTagInteger(char *buffer, TagPtr *tag);
 static long ParseTagData(char *buffer, TagPtr *tag);
 static long ParseTagDate(char *buffer, TagPtr *tag);
 static long ParseTagBoolean(char *buffer, TagPtr *tag, long type);
-static long GetNextTag(char *buffer, char **tag, long *start, long *empty);
+static long GetNextTag(char *buffer, XMLTokenPtr token);
+static long GetTokenKind(char *name, long length);
 static long FixDataMatchingTag(char *buffer, char *tag);
 static TagPtr NewTag(void);
+static TagPtr NewPermanentTag(void);
+static void *AllocateTagArena(long size);
 static char *NewSymbol(char *string);
+static char *NewPermanentSymbol(char *string);
 static void FreeSymbol(char *string);
+static TagPtr KeepTagList(TagPtr tag);
+
+struct Symbol {
+  long          refCount;
+  unsigned long hash;
+  char          string[1];
+};
+typedef struct Symbol Symbol, *SymbolPtr;
+
+// Symbols are interned in open addressed tables, one in BootX memory
+// and one in the tag arena, so keys can be compared by address.
+#define kSymbolTableSize (0x400)
+
+struct SymbolTable {
+  SymbolPtr *symbols;
+  long      size;	// zero or a power of two
+  long      count;
+  long      arena;
+};
+typedef struct SymbolTable SymbolTable, *SymbolTablePtr;
+
+static unsigned long SymbolHash(char *string);
+static SymbolPtr FindSymbol(SymbolTablePtr table, char *string,
+			    unsigned long hash);
+static SymbolPtr AddSymbol(SymbolTablePtr table, char *string,
+			   unsigned long hash);
+static long GrowSymbolTable(SymbolTablePtr table);
+static void InsertSymbol(SymbolPtr *symbols, long size, SymbolPtr symbol);
+
+static SymbolTable gSymbols;
+static SymbolTable gArenaSymbols = { 0, 0, 0, 1 };
 
 #if PLIST_DEBUG
 // for debugging parsing failures
@@ -67,10 +127,22 @@ static char *gLastTag;
 
 TagPtr GetProperty(TagPtr dict, char *key)
 {
-  TagPtr tagList, tag;
+  TagPtr        tagList, tag;
+  SymbolPtr     symbol;
+  char          *string, *arenaString;
+  unsigned long hash;
   
   if (dict->type != kTagTypeDict) return 0;
   
+  // Keys are interned, so a key that is not a symbol is in no dict.
+  // It can be in both tables while kept dicts are copied out.
+  hash = SymbolHash(key);
+  symbol = FindSymbol(&gSymbols, key, hash);
+  string = (symbol != 0) ? symbol->string : 0;
+  symbol = FindSymbol(&gArenaSymbols, key, hash);
+  arenaString = (symbol != 0) ? symbol->string : 0;
+  if ((string == 0) && (arenaString == 0)) return 0;
+  
   tag = 0;    // ?
   tagList = dict->tag;
   while (tagList) {
@@ -79,7 +151,7 @@ TagPtr GetProperty(TagPtr dict, char *key)
     
     if ((tag->type != kTagTypeKey) || (tag->string == 0)) continue;
     
-    if (!strcmp(tag->string, key)) {
+    if ((tag->string == string) || (tag->string == arenaString)) {
       return tag->tag;
     }
   }
@@ -87,10 +159,6 @@ TagPtr GetProperty(TagPtr dict, char *key)
   return 0;
 }
 
-// intended to look for two versions of the tag; now just for sizeof
-#define MATCHTAG(parsedTag, keyTag) \
-    (!strncmp(parsedTag, keyTag, sizeof(keyTag)-1))
-
 // a tag cache for iokit's super-plists (alas, to merge w/"Symbol" cache?)
 // we're not going to use the 0th element; it's used by the whole dict anyway
 static int lastid;
@@ -122,31 +190,8 @@ static void FreeTagCache()
   idtags = NULL;
 }
 
-// get the number from (e.g.): ID="3"
-static int ExtractID(char *tagName, int tagLen)
+static TagPtr TagFromRef(int refidx)
 {
-  char *idptr = tagName + tagLen;
-  int rval = 0;
-
-  while(*idptr != '>') {
-    idptr++;
-    if (MATCHTAG(idptr, kXMLTagID)) {
-      rval = strtol(idptr + sizeof(kXMLTagID)-1+1, 0, 0);  // -NUL +"
-      break;
-    } else if (MATCHTAG(idptr, kXMLTagIDREF)) {
-      rval = strtol(idptr + sizeof(kXMLTagIDREF)-1+1, 0, 0);  // -NUL +"
-      break;
-    }
-    // there can be multiple modifiers (integers have 'size' first)
-    while(*idptr != ' ' && *idptr != '>')  idptr++;
-  }
-
- return rval;
-}
-
-static TagPtr TagFromRef(char *tagName, int tagLen)
-{
-  int refidx = ExtractID(tagName, tagLen);
   TagPtr rval = NULL;
 
   if (refidx <= lastid)
@@ -226,68 +271,96 @@ long ParseXML(char *buffer, TagPtr *dict)
   return (length != -1) ? 0 : -1;
 }
 
-#define PARSESTASHINGTAG(tagBuf, keyTag, parseFunc) do { \
-    TagPtr extantTag = TagFromRef(tagBuf, sizeof(keyTag)-1); \
+#define PARSESTASHINGTAG(token, parseFunc) do { \
+    TagPtr extantTag = TagFromRef((token).id); \
     if (extantTag) { \
       *tag = extantTag; \
       length = 0; \
     } else { \
-      int tagid = ExtractID(tagName, sizeof(keyTag)-1); \
       length = parseFunc(buffer + pos, tag); \
-      if (tagid && length != -1) \
-	if (-1 == SaveTagRef(*tag, tagid)) \
+      if ((token).id && length != -1) \
+	if (-1 == SaveTagRef(*tag, (token).id)) \
 	  return -1; \
     } \
     } while(0)
 
 static long ParseNextTag(char *buffer, TagPtr *tag)
 {
-  long length, pos, empty = 0;
-  char *tagName;
-  TagPtr refTag;
+  long     length, pos;
+  XMLToken token;
+  TagPtr   refTag;
   
-  length = GetNextTag(buffer, &tagName, 0, &empty);
+  length = GetNextTag(buffer, &token);
   if (length == -1) return -1;
 #if PLIST_DEBUG
-  gLastTag = tagName;
+  gLastTag = token.name;
   gTagsParsed++;
 #endif
   
   pos = length;
-  if (MATCHTAG(tagName, kXMLTagPList)) {
-    length = 0;  // just a header; nothing to parse
-	// return-via-reference tag should be left alone
-  } else if (MATCHTAG(tagName, kXMLTagDict)) {
-    length = ParseTagList(buffer + pos, tag, kTagTypeDict, empty);
-  } else if (!strcmp(tagName, kXMLTagKey)) {
+  length = 0;
+  
+  // was it an end tag (indicated w/*tag = 0)
+  if (token.end) {
+    *tag = 0;
+    return pos;
+  }
+  
+  switch (token.kind) {
+  case kXMLTokenPList :
+    // just a header; nothing to parse
+    // return-via-reference tag should be left alone
+    break;
+    
+  case kXMLTokenDict :
+    length = ParseTagList(buffer + pos, tag, kTagTypeDict, token.empty);
+    break;
+    
+  case kXMLTokenKey :
     length = ParseTagKey(buffer + pos, tag);
-  } else if (MATCHTAG(tagName, kXMLTagReference) && 
-	(refTag = TagFromRef(tagName, sizeof(kXMLTagReference)-1))) {
-      *tag = refTag;
-      length = 0;
-  } else if (MATCHTAG(tagName, kXMLTagString)) {
-    PARSESTASHINGTAG(tagName, kXMLTagString, ParseTagString);
-  } else if (MATCHTAG(tagName, kXMLTagInteger)) {
-    PARSESTASHINGTAG(tagName, kXMLTagInteger, ParseTagInteger);
-  } else if (!strcmp(tagName, kXMLTagData)) {
+    break;
+    
+  case kXMLTokenString :
+    PARSESTASHINGTAG(token, ParseTagString);
+    break;
+    
+  case kXMLTokenInteger :
+    PARSESTASHINGTAG(token, ParseTagInteger);
+    break;
+    
+  case kXMLTokenData :
     length = ParseTagData(buffer + pos, tag);
-  } else if (!strcmp(tagName, kXMLTagDate)) {
+    break;
+    
+  case kXMLTokenDate :
     length = ParseTagDate(buffer + pos, tag);
-  } else if (!strcmp(tagName, kXMLTagFalse)) {
-    length = ParseTagBoolean(buffer + pos, tag, kTagTypeFalse);
-  } else if (!strcmp(tagName, kXMLTagTrue)) {
-    length = ParseTagBoolean(buffer + pos, tag, kTagTypeTrue);
-  } else if (MATCHTAG(tagName, kXMLTagArray)) {
-    length = ParseTagList(buffer + pos, tag, kTagTypeArray, empty);
-  } else {
+    break;
+    
+  case kXMLTokenFalse :
+  case kXMLTokenTrue :
+    // only <false/> and <true/> are booleans
+    if (token.empty) {
+      length = ParseTagBoolean(buffer + pos, tag,
+			       (token.kind == kXMLTokenTrue) ?
+			       kTagTypeTrue : kTagTypeFalse);
+    } else *tag = (TagPtr)-1;
+    break;
+    
+  case kXMLTokenArray :
+    length = ParseTagList(buffer + pos, tag, kTagTypeArray, token.empty);
+    break;
+    
+  case kXMLTokenReference :
+    refTag = TagFromRef(token.id);
+    if (refTag != 0) *tag = refTag;
+    else *tag = (TagPtr)-1;
+    break;
+    
+  default :
     // it wasn't parsed so we consumed no additional characters
-    length = 0;
-    if (tagName[0] == '/')  // was it an end tag (indicated w/*tag = 0)
-      *tag = 0;
-    else {
-//printf("ignored plist tag: %s (*tag: %x)\n", tagName, *tag);
-      *tag = (TagPtr)-1;  // we're *not* returning a tag
-    }
+//printf("ignored plist tag: %s (*tag: %x)\n", token.name, *tag);
+    *tag = (TagPtr)-1;  // we're *not* returning a tag
+    break;
   }
   
   if (length == -1) return -1;
@@ -503,50 +576,119 @@ static long ParseTagBoolean(char *buffer, TagPtr *tag, long type)
 }
 
 
-static long GetNextTag(char *buffer, char **tag, long *start, long *empty)
+// Read the next tag in one pass: its name, whether it is an end
+// or empty tag, and the value of an ID= or IDREF= attribute.
+static long GetNextTag(char *buffer, XMLTokenPtr token)
 {
-  long cnt, cnt2;
-  
-  if (tag == 0) return -1;
+  long cnt, nameStart, nameEnd;
+  char ch;
   
   // Find the start of the tag.
   cnt = 0;
-  while ((buffer[cnt] != '\0') && (buffer[cnt] != '<')) cnt++;
-  if (buffer[cnt] == '\0') return -1;
+  while ((ch = buffer[cnt]) != '<') {
+    if (ch == '\0') return -1;
+    cnt++;
+  }
+  cnt++;
   
-  // Find the end of the tag.
-  cnt2 = cnt + 1;
-  while ((buffer[cnt2] != '\0') && (buffer[cnt2] != '>')) cnt2++;
-  if (buffer[cnt2] == '\0') return -1;
-  if (empty && cnt2 > 1)
-    *empty = buffer[cnt2-1] == '/';
+  token->end = (buffer[cnt] == '/');
+  if (token->end) cnt++;
+  token->empty = 0;
+  token->id = 0;
   
-  // Fix the tag data.
-  *tag = buffer + cnt + 1;
-  buffer[cnt2] = '\0';
-  if (start) *start = cnt;
+  // Find the end of the name.
+  nameStart = cnt;
+  while (1) {
+    ch = buffer[cnt];
+    if ((ch == '\0') || (ch == '>') || (ch == '/') || (ch == ' ') ||
+	(ch == '\t') || (ch == '\r') || (ch == '\n')) break;
+    cnt++;
+  }
+  nameEnd = cnt;
   
-  return cnt2 + 1;
+  // Look through the attributes for the end of the tag.
+  while (1) {
+    ch = buffer[cnt];
+    if (ch == '\0') return -1;
+    if (ch == '>') break;
+    
+    token->empty = (ch == '/');
+    
+    if ((ch == 'I') && (token->id == 0)) {
+      if (!strncmp(buffer + cnt, kXMLTagID, sizeof(kXMLTagID) - 1)) {
+	token->id = strtol(buffer + cnt + sizeof(kXMLTagID) - 1, 0, 0);
+      } else if (!strncmp(buffer + cnt, kXMLTagIDREF,
+			  sizeof(kXMLTagIDREF) - 1)) {
+	token->id = strtol(buffer + cnt + sizeof(kXMLTagIDREF) - 1, 0, 0);
+      }
+    }
+    
+    cnt++;
+  }
+  
+  token->name = buffer + nameStart;
+  token->kind = GetTokenKind(token->name, nameEnd - nameStart);
+  buffer[nameEnd] = '\0';
+  
+  return cnt + 1;
 }
 
 
-static long FixDataMatchingTag(char *buffer, char *tag)
+// Pick the one tag name that can match from the first character and
+// the length, then compare against it.
+static long GetTokenKind(char *name, long length)
 {
-  long length, start, stop;
-  char *endTag;
-  
-  start = 0;
-  while (1) {
-    length = GetNextTag(buffer + start, &endTag, &stop, NULL);
-    if (length == -1) return -1;
+  char *tag;
+  long kind;
+  
+  switch (name[0]) {
+  case 'a' : tag = kXMLTagArray;     kind = kXMLTokenArray;     break;
+  case 'f' : tag = kXMLTagFalse;     kind = kXMLTokenFalse;     break;
+  case 'i' : tag = kXMLTagInteger;   kind = kXMLTokenInteger;   break;
+  case 'k' : tag = kXMLTagKey;       kind = kXMLTokenKey;       break;
+  case 'p' : tag = kXMLTagPList;     kind = kXMLTokenPList;     break;
+  case 'r' : tag = kXMLTagReference; kind = kXMLTokenReference; break;
+  case 's' : tag = kXMLTagString;    kind = kXMLTokenString;    break;
+  case 't' : tag = kXMLTagTrue;      kind = kXMLTokenTrue;      break;
+    
+  case 'd' :
+    // dict, data and date
+    if (length != 4) return kXMLTokenUnknown;
+    if (name[1] == 'i') { tag = kXMLTagDict; kind = kXMLTokenDict; }
+    else if (name[3] == 'a') { tag = kXMLTagData; kind = kXMLTokenData; }
+    else { tag = kXMLTagDate; kind = kXMLTokenDate; }
+    break;
     
-    if ((*endTag == '/') && !strcmp(endTag + 1, tag)) break;
-    start += length;
+  default : return kXMLTokenUnknown;
   }
   
-  buffer[start + stop] = '\0';
+  if ((length != strlen(tag)) || strncmp(name, tag, length)) {
+    return kXMLTokenUnknown;
+  }
+  
+  return kind;
+}
+
+
+// Terminate the data at the matching end tag.
+// Return the length through the end tag.
+static long FixDataMatchingTag(char *buffer, char *tag)
+{
+  long cnt, length;
+  char ch;
+  
+  length = strlen(tag);
+  
+  for (cnt = 0; (ch = buffer[cnt]) != '\0'; cnt++) {
+    if ((ch == '<') && (buffer[cnt + 1] == '/') &&
+	!strncmp(buffer + cnt + 2, tag, length) &&
+	(buffer[cnt + 2 + length] == '>')) {
+      buffer[cnt] = '\0';
+      return cnt + 3 + length;
+    }
+  }
   
-  return start + length;
+  return -1;
 }
 
 
@@ -554,7 +696,55 @@ static long FixDataMatchingTag(char *buffer, char *tag)
 
 static TagPtr gTagsFree;
 
+// While the arena is set, parsed tags and symbols come from it
+// instead of BootX memory, and are all freed by FreeTagArena.
+static char   *gTagArenaNext;
+static char   *gTagArenaEnd;
+
+void InitTagArena(char *addr, long size)
+{
+  gTagArenaNext = addr;
+  gTagArenaEnd  = addr + size;
+  
+  gArenaSymbols.symbols = 0;
+  gArenaSymbols.size = 0;
+  gArenaSymbols.count = 0;
+}
+
+
+static void *AllocateTagArena(long size)
+{
+  char *addr;
+  
+  size = (size + 7) & ~7;
+  if ((gTagArenaNext == 0) || ((gTagArenaNext + size) > gTagArenaEnd)) {
+    return 0;
+  }
+  
+  addr = gTagArenaNext;
+  gTagArenaNext += size;
+  
+  return addr;
+}
+
+
 static TagPtr NewTag(void)
+{
+  TagPtr tag;
+  
+  tag = AllocateTagArena(sizeof(Tag));
+  if (tag == 0) return NewPermanentTag();
+  
+  tag->type = kTagTypeNone;
+  tag->string = 0;
+  tag->tag = 0;
+  tag->tagNext = 0;
+  
+  return tag;
+}
+
+
+static TagPtr NewPermanentTag(void)
 {
   long   cnt;
   TagPtr tag;
@@ -602,37 +792,44 @@ void FreeTag(TagPtr tag)
 }
 
 
-struct Symbol {
-  long          refCount;
-  struct Symbol *next;
-  char          string[1];
-};
-typedef struct Symbol Symbol, *SymbolPtr;
-
-static SymbolPtr FindSymbol(char *string, SymbolPtr *prevSymbol);
-
-static SymbolPtr gSymbolsHead;
+static char *NewSymbol(char *string)
+{
+  unsigned long hash;
+  SymbolPtr     symbol;
+  
+  // Look for string in the tables of symbols.
+  hash = SymbolHash(string);
+  symbol = FindSymbol(&gSymbols, string, hash);
+  if (symbol == 0) symbol = FindSymbol(&gArenaSymbols, string, hash);
+  
+  // Add the new symbol to the arena if there is room.
+  if (symbol == 0) {
+    if (gTagArenaNext != 0) {
+      symbol = AddSymbol(&gArenaSymbols, string, hash);
+    }
+    if (symbol == 0) symbol = AddSymbol(&gSymbols, string, hash);
+    if (symbol == 0) return 0;
+  }
+  
+  // Update the refCount and return the string.
+  symbol->refCount++;
+  return symbol->string;
+}
 
 
-static char *NewSymbol(char *string)
+static char *NewPermanentSymbol(char *string)
 {
-  SymbolPtr symbol;
+  unsigned long hash;
+  SymbolPtr     symbol;
   
-  // Look for string in the list of symbols.
-  symbol = FindSymbol(string, 0);
+  // Look for string in the table of symbols.
+  hash = SymbolHash(string);
+  symbol = FindSymbol(&gSymbols, string, hash);
   
   // Add the new symbol.
   if (symbol == 0) {
-    symbol = AllocateBootXMemory(sizeof(Symbol) + strlen(string));
+    symbol = AddSymbol(&gSymbols, string, hash);
     if (symbol == 0) return 0;
-    
-    // Set the symbol's data.
-    symbol->refCount = 0;
-    strcpy(symbol->string, string);
-    
-    // Add the symbol to the list.
-    symbol->next = gSymbolsHead;
-    gSymbolsHead = symbol;
   }
   
   // Update the refCount and return the string.
@@ -645,46 +842,213 @@ static char *NewSymbol(char *string)
 static void FreeSymbol(char *string)
 { 
 #if 0
-  SymbolPtr symbol, prev;
+  SymbolPtr symbol;
   
-  // Look for string in the list of symbols.
-  symbol = FindSymbol(string, &prev);
+  // Look for string in the table of symbols.
+  symbol = FindSymbol(&gSymbols, string, SymbolHash(string));
   if (symbol == 0) return;
   
   // Update the refCount.
   symbol->refCount--;
   
-  if (symbol->refCount != 0) return;
+  // Symbols stay in the table; removing them would need tombstones.
+#endif
+}
+
+
+static unsigned long SymbolHash(char *string)
+{
+  unsigned long hash = 0;
   
-  // Remove the symbol from the list.
-  if (prev != 0) prev->next = symbol->next;
-  else gSymbolsHead = symbol->next;
+  while (*string != '\0') hash = hash * 31 + *string++;
   
-  // Free the symbol's memory.
-  free(symbol);
-#endif
+  return hash;
 }
 
 
-static SymbolPtr FindSymbol(char *string, SymbolPtr *prevSymbol)
+static SymbolPtr FindSymbol(SymbolTablePtr table, char *string,
+			    unsigned long hash)
 {
-  SymbolPtr symbol, prev;
+  long      index;
+  SymbolPtr symbol;
   
-  symbol = gSymbolsHead;
-  prev = 0;
+  if (table->size == 0) return 0;
   
-  while (symbol != 0) {
-    if (!strcmp(symbol->string, string)) break;
+  index = hash & (table->size - 1);
+  while (1) {
+    symbol = table->symbols[index];
+    if (symbol == 0) break;
     
-    prev = symbol;
-    symbol = symbol->next;
+    if ((symbol->hash == hash) && !strcmp(symbol->string, string)) break;
+    
+    index = (index + 1) & (table->size - 1);
+  }
+  
+  return symbol;
+}
+
+
+static SymbolPtr AddSymbol(SymbolTablePtr table, char *string,
+			   unsigned long hash)
+{
+  long      size;
+  SymbolPtr symbol;
+  
+  // Keep the table at most three quarters full.
+  if ((table->count + 1) > (table->size / 4 * 3)) {
+    if (GrowSymbolTable(table) == -1) return 0;
   }
   
-  if ((symbol != 0) && (prevSymbol != 0)) *prevSymbol = prev;
+  size = sizeof(Symbol) + strlen(string);
+  if (table->arena) symbol = AllocateTagArena(size);
+  else symbol = AllocateBootXMemory(size);
+  if (symbol == 0) return 0;
+  
+  // Set the symbol's data.
+  symbol->refCount = 0;
+  symbol->hash = hash;
+  strcpy(symbol->string, string);
+  
+  InsertSymbol(table->symbols, table->size, symbol);
+  table->count++;
   
   return symbol;
 }
 
+
+static long GrowSymbolTable(SymbolTablePtr table)
+{
+  long      cnt, size;
+  SymbolPtr *symbols;
+  
+  size = (table->size != 0) ? (table->size * 2) : kSymbolTableSize;
+  
+  if (table->arena) symbols = AllocateTagArena(size * sizeof(SymbolPtr));
+  else symbols = AllocateBootXMemory(size * sizeof(SymbolPtr));
+  if (symbols == 0) return -1;
+  
+  bzero(symbols, size * sizeof(SymbolPtr));
+  
+  // Move the symbols into the new table.
+  for (cnt = 0; cnt < table->size; cnt++) {
+    if (table->symbols[cnt] != 0) {
+      InsertSymbol(symbols, size, table->symbols[cnt]);
+    }
+  }
+  
+  table->symbols = symbols;
+  table->size = size;
+  
+  return 0;
+}
+
+
+static void InsertSymbol(SymbolPtr *symbols, long size, SymbolPtr symbol)
+{
+  long index;
+  
+  index = symbol->hash & (size - 1);
+  while (symbols[index] != 0) index = (index + 1) & (size - 1);
+  
+  symbols[index] = symbol;
+}
+
+
+void FreeTagArena(void)
+{
+  gTagArenaNext = 0;
+  gTagArenaEnd  = 0;
+  
+  gArenaSymbols.symbols = 0;
+  gArenaSymbols.size = 0;
+  gArenaSymbols.count = 0;
+}
+
+
+// Copy a tag tree out of the arena into BootX memory.  Only the keys
+// of a dict and the elements of an array are followed through tagNext.
+// A value's tagNext is not part of the tree; AddPersonalities uses it
+// to chain the personality dicts of every module.
+TagPtr KeepTag(TagPtr tag)
+{
+  TagPtr newTag;
+  
+  if (tag == 0) return 0;
+  
+  newTag = NewPermanentTag();
+  if (newTag == 0) return 0;
+  
+  newTag->type = tag->type;
+  newTag->string = 0;
+  newTag->tag = 0;
+  newTag->tagNext = 0;
+  
+  if (tag->string != 0) {
+    newTag->string = NewPermanentSymbol(tag->string);
+    if (newTag->string == 0) return 0;
+  }
+  
+  if (tag->tag != 0) {
+    if ((tag->type == kTagTypeDict) || (tag->type == kTagTypeArray)) {
+      newTag->tag = KeepTagList(tag->tag);
+    } else {
+      newTag->tag = KeepTag(tag->tag);
+    }
+    if (newTag->tag == 0) return 0;
+  }
+  
+  return newTag;
+}
+
+
+static TagPtr KeepTagList(TagPtr tag)
+{
+  TagPtr newTag, tagList = 0, *tagLink = &tagList;
+  
+  for (; tag != 0; tag = tag->tagNext) {
+    newTag = KeepTag(tag);
+    if (newTag == 0) return 0;
+    
+    *tagLink = newTag;
+    tagLink = &newTag->tagNext;
+    
+    // A reference repeated back to back links a tag to itself.
+    if (tag->tagNext == tag) break;
+  }
+  
+  return tagList;
+}
+
+
+// Turn the tags of a plist index into a Tag tree in place.  Each
+// field but the type is an offset from base or zero.
+long RelocateTags(char *base, long length, TagPtr tags, long numTags)
+{
+  long          cnt;
+  unsigned long string, tag, tagNext;
+  
+  for (cnt = 0; cnt < numTags; cnt++) {
+    string  = (unsigned long)tags[cnt].string;
+    tag     = (unsigned long)tags[cnt].tag;
+    tagNext = (unsigned long)tags[cnt].tagNext;
+    if ((string >= length) || (tag >= length) || (tagNext >= length)) {
+      return -1;
+    }
+    
+    // Strings are interned so GetProperty can find the keys.
+    if (string != 0) {
+      tags[cnt].string = NewSymbol(base + string);
+      if (tags[cnt].string == 0) return -1;
+    }
+    
+    tags[cnt].tag = (tag != 0) ? (TagPtr)(base + tag) : 0;
+    tags[cnt].tagNext = (tagNext != 0) ? (TagPtr)(base + tagNext) : 0;
+  }
+  
+  return 0;
+}
+
+
 #if PLIST_DEBUG
 static void DumpTagDict(TagPtr tag, long depth);
 static void DumpTagKey(TagPtr tag, long depth);
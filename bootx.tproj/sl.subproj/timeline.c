@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2000 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ * 
+ * The contents of this file constitute Original Code as defined in and
+ * are subject to the Apple Public Source License Version 1.1 (the
+ * "License").  You may not use this file except in compliance with the
+ * License.  Please obtain a copy of the License at
+ * http://www.apple.com/publicsource and read it before using this file.
+ * 
+ * This Original Code and all software distributed under the License are
+ * distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON-INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * @APPLE_LICENSE_HEADER_END@
+ */
+/*
+ *  timeline.c - Records the times of the phases of the boot.
+ *
+ *  Copyright (c) 2005 Apple Computer, Inc.
+ *
+ *  DRI: Josh de Cesare
+ */
+
+#include <sl.h>
+
+// Each phase of the boot is bracketed by TimelineBegin and TimelineEnd,
+// which note the timebase.  SaveTimeline puts the events in /chosen as
+// BootXTimeline, which timeline-trace turns into a trace for viewing.
+// The property is a header:
+//   unsigned long  signature;    'BXTL'
+//   unsigned long  version;      kTimelineVersion
+//   unsigned long  tbFrequency;  timebase ticks per second
+//   unsigned long  numEvents;
+//   unsigned long  namesLength;
+//   unsigned long  dropped;      events lost once the table was full
+// followed by the events:
+//   unsigned long  timeHigh;     timebase, high word
+//   unsigned long  timeLow;      and low word
+//   unsigned short name;         offset of the name in the names
+//   unsigned short type;         'B'egin, 'E'nd or 'I'nstant
+//   unsigned long  arg;
+// and then the NUL terminated names.
+
+#define kTimelineSignature (0x4258544C)
+#define kTimelineVersion   (1)
+#define kTimelineMaxEvents (1024)
+#define kTimelineNamesSize (0x2000)
+
+// The phases' names are added first, so there is always room for
+// them, and the last kTimelineReservedEvents events are kept for the
+// phases, so the ones at the end of the boot are not lost to the
+// kexts'.  ReadDriverPLists is left out, as it is once per batch.
+#define kTimelineReservedEvents (128)
+
+struct TimelineHeader {
+  unsigned long  signature;
+  unsigned long  version;
+  unsigned long  tbFrequency;
+  unsigned long  numEvents;
+  unsigned long  namesLength;
+  unsigned long  dropped;
+};
+typedef struct TimelineHeader TimelineHeader, *TimelineHeaderPtr;
+
+struct TimelineEvent {
+  unsigned long  timeHigh;
+  unsigned long  timeLow;
+  unsigned short name;
+  unsigned short type;
+  unsigned long  arg;
+};
+typedef struct TimelineEvent TimelineEvent, *TimelineEventPtr;
+
+static void AddTimelineEvent(char *name, long type, long arg);
+static long FindTimelineName(char *name);
+
+static char *gTimelinePhaseNames[] = {
+  "InitEverything", "GetBootPaths", "LoadKernelCache",
+  "DecompressKernelCache", "LoadKernel", "DecompressKernel",
+  "LoadDrivers", "LoadDriverIndex", "LoadMKext", "VerifyMKext",
+  "MatchModules", "LoadMatchedModules", "SetUpBootArgs", "SaveTimeline",
+  0
+};
+
+static TimelineEvent gTimelineEvents[kTimelineMaxEvents];
+static long          gTimelineNumEvents;
+static long          gTimelineDropped;
+static char          gTimelineNames[kTimelineNamesSize];
+static long          gTimelineNamesLength;
+static long          gTimelineTimebase;
+static long          gTimelinePhaseNamesLength;
+static long          gTimelineOpenEvents;
+
+void InitTimeline(void)
+{
+  unsigned long pvr;
+  long          cnt;
+  
+  // The 601 has no timebase, so there is nothing to record.
+  __asm__ volatile("mfpvr %0" : "=r" (pvr));
+  gTimelineTimebase = ((pvr >> 16) != 1);
+  
+  for (cnt = 0; gTimelinePhaseNames[cnt] != 0; cnt++)
+    FindTimelineName(gTimelinePhaseNames[cnt]);
+  gTimelinePhaseNamesLength = gTimelineNamesLength;
+}
+
+void TimelineBegin(char *name, long arg)
+{
+  AddTimelineEvent(name, 'B', arg);
+}
+
+void TimelineEnd(char *name, long arg)
+{
+  AddTimelineEvent(name, 'E', arg);
+}
+
+void TimelineMark(char *name, long arg)
+{
+  AddTimelineEvent(name, 'I', arg);
+}
+
+// Save the timeline in /chosen.  Anything recorded after this is not
+// seen by the kernel.
+void SaveTimeline(void)
+{
+  TimelineHeaderPtr header = (TimelineHeaderPtr)kLoadAddr;
+  CICell            cpuPH;
+  unsigned long     tbFrequency = 0;
+  long              eventsSize;
+  
+  if (!gTimelineTimebase) return;
+  
+  TimelineMark("SaveTimeline", gTimelineNumEvents);
+  
+  cpuPH = SearchForNode(0, 1, "device_type", "cpu");
+  if (cpuPH != 0)
+    GetProp(cpuPH, "timebase-frequency", (char *)&tbFrequency, 4);
+  
+  // Lay the property out in the Load Area.
+  eventsSize = gTimelineNumEvents * sizeof(TimelineEvent);
+  header->signature = kTimelineSignature;
+  header->version = kTimelineVersion;
+  header->tbFrequency = tbFrequency;
+  header->numEvents = gTimelineNumEvents;
+  header->namesLength = gTimelineNamesLength;
+  header->dropped = gTimelineDropped;
+  bcopy(gTimelineEvents, header + 1, eventsSize);
+  bcopy(gTimelineNames, (char *)(header + 1) + eventsSize,
+	gTimelineNamesLength);
+  
+  printf("Boot timeline: %d events, %d dropped\n",
+	 gTimelineNumEvents, gTimelineDropped);
+  
+  SetProp(gChosenPH, "BootXTimeline", (char *)header,
+	  sizeof(TimelineHeader) + eventsSize + gTimelineNamesLength);
+}
+
+// Private Functions
+
+static void AddTimelineEvent(char *name, long type, long arg)
+{
+  TimelineEventPtr event;
+  unsigned long    high, low, high2;
+  long             nameOffset, drop;
+  
+  if (!gTimelineTimebase) return;
+  
+  nameOffset = FindTimelineName(name);
+  drop = (nameOffset == -1) || (gTimelineNumEvents == kTimelineMaxEvents);
+  
+  // Other events stay out of the reserved slots, except for the end
+  // of one whose beginning was recorded, so the trace still nests.
+  if (!drop && (nameOffset >= gTimelinePhaseNamesLength)) {
+    if (type == 'E') {
+      if (gTimelineOpenEvents == 0) drop = 1;
+      else gTimelineOpenEvents--;
+    } else if (gTimelineNumEvents >=
+	       (kTimelineMaxEvents - kTimelineReservedEvents)) {
+      drop = 1;
+    } else if (type == 'B') gTimelineOpenEvents++;
+  }
+  
+  if (drop) {
+    gTimelineDropped++;
+    return;
+  }
+  
+  // Read the upper half again in case the lower half carried into it.
+  do {
+    __asm__ volatile("mftbu %0" : "=r" (high));
+    __asm__ volatile("mftb %0" : "=r" (low));
+    __asm__ volatile("mftbu %0" : "=r" (high2));
+  } while (high != high2);
+  
+  event = &gTimelineEvents[gTimelineNumEvents++];
+  event->timeHigh = high;
+  event->timeLow = low;
+  event->name = nameOffset;
+  event->type = type;
+  event->arg = arg;
+}
+
+// Return the offset of name in the names, adding it if it is new.
+// The names are compared by contents, since a kext's name is passed
+// in a buffer that is reused.
+static long FindTimelineName(char *name)
+{
+  long offset, length;
+  
+  for (offset = 0; offset < gTimelineNamesLength; ) {
+    if (!strcmp(gTimelineNames + offset, name)) return offset;
+    offset += strlen(gTimelineNames + offset) + 1;
+  }
+  
+  length = strlen(name) + 1;
+  if ((gTimelineNamesLength + length) > kTimelineNamesSize) return -1;
+  
+  offset = gTimelineNamesLength;
+  strcpy(gTimelineNames + offset, name);
+  gTimelineNamesLength += length;
+  
+  return offset;
+}
@@ -0,0 +1,569 @@
+/*
+ * Copyright (c) 2000 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ * 
+ * The contents of this file constitute Original Code as defined in and
+ * are subject to the Apple Public Source License Version 1.1 (the
+ * "License").  You may not use this file except in compliance with the
+ * License.  Please obtain a copy of the License at
+ * http://www.apple.com/publicsource and read it before using this file.
+ * 
+ * This Original Code and all software distributed under the License are
+ * distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON-INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * @APPLE_LICENSE_HEADER_END@
+ */
+/*
+ *  plist-index.c - Writes the plist index BootX reads in place of
+ *                  the kexts' Info.plists.
+ *
+ *  Copyright (c) 2005 Apple Computer, Inc.
+ *
+ *  DRI: Josh de Cesare
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+// BootX's plist.c and adler32.c are built here as they are, so the
+// tags in the index are the ones BootX would build from the XML.
+// sl.h is kept out, since libclite.h does not agree with the host's
+// headers, and what the files need from it is defined here.
+#define _BOOTX_SL_H_
+
+typedef enum {
+  kTagTypeNone = 0,
+  kTagTypeDict,
+  kTagTypeKey,
+  kTagTypeString,
+  kTagTypeInteger,
+  kTagTypeData,
+  kTagTypeDate,
+  kTagTypeFalse,
+  kTagTypeTrue,
+  kTagTypeArray
+} TagType;
+
+struct Tag {
+  TagType     type;
+  char       *string;
+  struct Tag *tag;
+  struct Tag *tagNext;
+};
+typedef struct Tag Tag, *TagPtr;
+
+void *AllocateBootXMemory(long size);
+
+// Externs for adler32.c
+#define ADLER32_USER (1)
+
+void InitAdler32(void);
+unsigned long Adler32(unsigned char *buffer, long length);
+unsigned long UpdateAdler32(unsigned long adler,
+			    unsigned char *buffer, long length);
+
+// Externs for plist.c
+#define PLIST_DEBUG 0
+
+TagPtr GetProperty(TagPtr dict, char *key);
+long ParseXML(char *buffer, TagPtr *dict);
+void FreeTag(TagPtr tag);
+void InitTagArena(char *addr, long size);
+void FreeTagArena(void);
+TagPtr KeepTag(TagPtr tag);
+
+#include "../bootx.tproj/sl.subproj/adler32.c"
+#include "../bootx.tproj/sl.subproj/plist.c"
+
+// The index is read by LoadDriverIndex in BootX's drivers.c, and the
+// definitions here must match the ones there.  Tags are laid out as
+// BootX's Tags on a 32 bit PowerPC, with offsets for the pointers.
+#define kPListIndexSignature1 'PLIX'
+#define kPListIndexSignature2 'MOSX'
+#define kPListIndexVersion    (1)
+
+#define kPListIndexHeaderSize (8 * 4)
+#define kPListIndexKextSize   (6 * 4)
+#define kPListIndexTagSize    (4 * 4)
+
+struct Kext {
+  TagPtr dict;
+  long   bundleID;	// offsets in gData or -1
+  long   required;
+  long   driverPath;
+  long   plistAddr;
+  long   plistLength;
+};
+typedef struct Kext Kext;
+
+// Tags are numbered in the order they are first reached.  A tag
+// shared through an IDREF, or linked to itself, is written once.
+struct IndexTag {
+  TagPtr tag;
+  long   string;	// offset in gData or -1
+  long   sub;		// tag numbers or -1
+  long   next;
+};
+typedef struct IndexTag IndexTag;
+
+// Tags and strings are found by address in open addressed tables.
+// The strings are all symbols, so each is stored once.
+struct AddrTable {
+  void **addrs;
+  long *values;
+  long size;		// zero or a power of two
+  long count;
+};
+typedef struct AddrTable AddrTable;
+
+#define kAddrTableSize (0x1000)
+
+#define kCFBundleType2 (0)
+#define kCFBundleType3 (1)
+
+static long IndexDirectory(char *dirPath, char *indexPath, long plugin);
+static long IndexKext(char *kextPath, char *indexPath, long bundleType);
+static long WriteIndex(char *fileName);
+static long AddTag(TagPtr tag);
+static long AddString(char *string);
+static long AddData(char *data, long length);
+static long FindAddr(AddrTable *table, void *addr);
+static void InsertAddr(AddrTable *table, void *addr, long value);
+static void *Grow(void *array, long *size, long count, long elementSize);
+static void PutLong(unsigned char *buffer, unsigned long value);
+static int CompareNames(const void *name1, const void *name2);
+
+char *gToolName;
+
+static IndexTag  *gTags;
+static long      gNumTags, gTagsSize;
+static Kext      *gKexts;
+static long      gNumKexts, gKextsSize;
+static char      *gData;
+static long      gDataLength, gDataSize;
+static AddrTable gTagTable, gStringTable;
+
+
+int main(int argc, char **argv)
+{
+  struct stat    statBuf;
+  struct timeval times[2];
+  
+  gToolName = *argv;
+  
+  if (argc != 3) {
+    fprintf(stderr, "Usage: %s Extensions-folder index-file\n", gToolName);
+    return -1;
+  }
+  
+  if (stat(argv[1], &statBuf) != 0) {
+    fprintf(stderr, "%s: failed to stat %s\n", gToolName, argv[1]);
+    return -1;
+  }
+  
+  if (IndexDirectory(argv[1], "", 0) == -1) return -1;
+  
+  if (WriteIndex(argv[2]) == -1) return -1;
+  
+  // BootX uses the index only if it is one second newer than the
+  // folder, like the mkext.
+  times[0].tv_sec = statBuf.st_mtime + 1;
+  times[0].tv_usec = 0;
+  times[1] = times[0];
+  if (utimes(argv[2], times) != 0) {
+    fprintf(stderr, "%s: failed to set the time of %s\n",
+	    gToolName, argv[2]);
+    return -1;
+  }
+  
+  return 0;
+}
+
+
+void *AllocateBootXMemory(long size)
+{
+  return calloc(1, size);
+}
+
+
+// Index the kexts in a folder in the order FileLoadDrivers visits
+// them, which is the order of the names in the HFS+ catalog.
+// FindModule takes the first kext with a bundle ID, so the order
+// matters.  indexPath is the folder's path below Extensions, in
+// BootX's form.
+static long IndexDirectory(char *dirPath, char *indexPath, long plugin)
+{
+  DIR           *dir;
+  struct dirent *entry;
+  struct stat   statBuf;
+  char          **names, kextPath[1024], kextIndexPath[1024];
+  char          path[1024 + 32];
+  long          cnt, numNames, namesSize, length, bundleType, ret;
+  
+  dir = opendir(dirPath);
+  if (dir == NULL) {
+    if (plugin) return 0;
+    fprintf(stderr, "%s: failed to open %s\n", gToolName, dirPath);
+    return -1;
+  }
+  
+  names = 0;
+  numNames = namesSize = 0;
+  while ((entry = readdir(dir)) != NULL) {
+    length = strlen(entry->d_name);
+    if ((length < 5) || strcmp(entry->d_name + length - 5, ".kext")) continue;
+    
+    names = Grow(names, &namesSize, numNames + 1, sizeof(char *));
+    names[numNames] = strdup(entry->d_name);
+    if (names[numNames] == NULL) {
+      fprintf(stderr, "%s: out of memory\n", gToolName);
+      exit(-1);
+    }
+    numNames++;
+  }
+  closedir(dir);
+  
+  qsort(names, numNames, sizeof(char *), CompareNames);
+  
+  ret = 0;
+  for (cnt = 0; cnt < numNames; cnt++) {
+    snprintf(kextPath, sizeof(kextPath), "%s/%s", dirPath, names[cnt]);
+    if ((stat(kextPath, &statBuf) != 0) || !S_ISDIR(statBuf.st_mode)) {
+      continue;
+    }
+    
+    snprintf(path, sizeof(path), "%s/Contents", kextPath);
+    if (stat(path, &statBuf) == 0) bundleType = kCFBundleType2;
+    else bundleType = kCFBundleType3;
+    
+    snprintf(kextIndexPath, sizeof(kextIndexPath), "%s\\%s",
+	     indexPath, names[cnt]);
+    
+    if (IndexKext(kextPath, kextIndexPath, bundleType) == -1) {
+      fprintf(stderr, "%s: skipping %s\n", gToolName, kextPath);
+    }
+    
+    if (!plugin) {
+      snprintf(path, sizeof(path), "%s/%sPlugIns", kextPath,
+	       (bundleType == kCFBundleType2) ? "Contents/" : "");
+      snprintf(kextIndexPath, sizeof(kextIndexPath), "%s\\%s\\%sPlugIns",
+	       indexPath, names[cnt],
+	       (bundleType == kCFBundleType2) ? "Contents\\" : "");
+      ret = IndexDirectory(path, kextIndexPath, 1);
+      if (ret == -1) break;
+    }
+  }
+  
+  for (cnt = 0; cnt < numNames; cnt++) free(names[cnt]);
+  free(names);
+  
+  return ret;
+}
+
+
+static long IndexKext(char *kextPath, char *indexPath, long bundleType)
+{
+  FILE   *file;
+  char   path[1024 + 32], *plist, *buffer;
+  long   length;
+  TagPtr dict, prop;
+  Kext   *kext;
+  
+  snprintf(path, sizeof(path), "%s/%sInfo.plist", kextPath,
+	   (bundleType == kCFBundleType2) ? "Contents/" : "");
+  
+  file = fopen(path, "rb");
+  if (file == NULL) return -1;
+  fseek(file, 0, SEEK_END);
+  length = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  
+  plist = malloc(length + 1);
+  buffer = malloc(length + 1);
+  if ((plist == NULL) || (buffer == NULL) ||
+      (fread(plist, 1, length, file) != length)) {
+    fclose(file);
+    free(plist);
+    free(buffer);
+    return -1;
+  }
+  fclose(file);
+  plist[length] = '\0';
+  
+  // The parser writes into the buffer, so keep the text separately.
+  // The tags it builds are kept until the index is written.
+  memcpy(buffer, plist, length + 1);
+  if ((ParseXML(buffer, &dict) == -1) || (dict == 0)) {
+    free(plist);
+    free(buffer);
+    return -1;
+  }
+  free(buffer);
+  
+  gKexts = Grow(gKexts, &gKextsSize, gNumKexts + 1, sizeof(Kext));
+  kext = gKexts + gNumKexts++;
+  
+  kext->dict = dict;
+  
+  // Use the same tests as XML2Module.
+  prop = GetProperty(dict, "CFBundleIdentifier");
+  if ((prop != 0) && (prop->string != 0)) {
+    kext->bundleID = AddString(prop->string);
+  } else kext->bundleID = -1;
+  
+  prop = GetProperty(dict, "OSBundleRequired");
+  if ((prop != 0) && (prop->type == kTagTypeString)) {
+    kext->required = AddString(prop->string);
+  } else kext->required = -1;
+  
+  snprintf(path, sizeof(path), "%s\\%s", indexPath,
+	   (bundleType == kCFBundleType2) ? "Contents\\MacOS\\" : "");
+  kext->driverPath = AddData(path, strlen(path) + 1);
+  
+  kext->plistAddr = AddData(plist, length + 1);
+  kext->plistLength = length;
+  
+  free(plist);
+  
+  return 0;
+}
+
+
+static long WriteIndex(char *fileName)
+{
+  FILE          *file;
+  unsigned char *index, *buffer;
+  long          cnt, dict, length, tagsStart, dataStart;
+  IndexTag      *tag;
+  Kext          *kext;
+  
+  // Number the tags, which adds their strings to the data.
+  for (cnt = 0; cnt < gNumKexts; cnt++) AddTag(gKexts[cnt].dict);
+  
+  tagsStart = kPListIndexHeaderSize + gNumKexts * kPListIndexKextSize;
+  dataStart = tagsStart + gNumTags * kPListIndexTagSize;
+  length = dataStart + gDataLength;
+  
+#define TAG(index)   (((index) < 0) ? 0 : (tagsStart + (index) * kPListIndexTagSize))
+#define DATA(offset) (((offset) < 0) ? 0 : (dataStart + (offset)))
+  
+  index = calloc(1, length);
+  if (index == NULL) {
+    fprintf(stderr, "%s: out of memory\n", gToolName);
+    return -1;
+  }
+  
+  buffer = index + kPListIndexHeaderSize;
+  for (cnt = 0; cnt < gNumKexts; cnt++) {
+    kext = gKexts + cnt;
+    dict = FindAddr(&gTagTable, kext->dict);
+    PutLong(buffer +  0, TAG(dict));
+    PutLong(buffer +  4, DATA(kext->bundleID));
+    PutLong(buffer +  8, DATA(kext->required));
+    PutLong(buffer + 12, DATA(kext->driverPath));
+    PutLong(buffer + 16, DATA(kext->plistAddr));
+    PutLong(buffer + 20, kext->plistLength);
+    buffer += kPListIndexKextSize;
+  }
+  
+  for (cnt = 0; cnt < gNumTags; cnt++) {
+    tag = gTags + cnt;
+    PutLong(buffer +  0, tag->tag->type);
+    PutLong(buffer +  4, DATA(tag->string));
+    PutLong(buffer +  8, TAG(tag->sub));
+    PutLong(buffer + 12, TAG(tag->next));
+    buffer += kPListIndexTagSize;
+  }
+  
+  memcpy(buffer, gData, gDataLength);
+  
+  PutLong(index +  0, kPListIndexSignature1);
+  PutLong(index +  4, kPListIndexSignature2);
+  PutLong(index +  8, length);
+  PutLong(index + 16, kPListIndexVersion);
+  PutLong(index + 20, gNumKexts);
+  PutLong(index + 24, gNumTags);
+  PutLong(index + 12, Adler32(index + 16, length - 16));
+  
+  file = fopen(fileName, "wb");
+  if (file == NULL) {
+    fprintf(stderr, "%s: failed to open %s\n", gToolName, fileName);
+    return -1;
+  }
+  
+  if (fwrite(index, 1, length, file) != length) {
+    fprintf(stderr, "%s: failed to write %s\n", gToolName, fileName);
+    fclose(file);
+    return -1;
+  }
+  
+  fclose(file);
+  free(index);
+  
+  return 0;
+}
+
+
+// Number a tag and the tags it links to, and return its number, or
+// -1 for no tag.  A tag is numbered before its links are followed, so
+// a tag linked to itself is reached only once.
+static long AddTag(TagPtr tag)
+{
+  long number, sub, next;
+  
+  if (tag == 0) return -1;
+  
+  number = FindAddr(&gTagTable, tag);
+  if (number != -1) return number;
+  
+  number = gNumTags++;
+  gTags = Grow(gTags, &gTagsSize, gNumTags, sizeof(IndexTag));
+  gTags[number].tag = tag;
+  InsertAddr(&gTagTable, tag, number);
+  
+  gTags[number].string = (tag->string != 0) ? AddString(tag->string) : -1;
+  sub = AddTag(tag->tag);
+  next = AddTag(tag->tagNext);
+  
+  // gTags may have moved.
+  gTags[number].sub = sub;
+  gTags[number].next = next;
+  
+  return number;
+}
+
+
+// Add a symbol to the data once, and return its offset.
+static long AddString(char *string)
+{
+  long offset;
+  
+  offset = FindAddr(&gStringTable, string);
+  if (offset != -1) return offset;
+  
+  offset = AddData(string, strlen(string) + 1);
+  InsertAddr(&gStringTable, string, offset);
+  
+  return offset;
+}
+
+
+static long AddData(char *data, long length)
+{
+  long offset = gDataLength;
+  
+  gData = Grow(gData, &gDataSize, gDataLength + length, 1);
+  memcpy(gData + gDataLength, data, length);
+  gDataLength += length;
+  
+  return offset;
+}
+
+
+static long FindAddr(AddrTable *table, void *addr)
+{
+  long index;
+  
+  if (table->size == 0) return -1;
+  
+  index = ((unsigned long)addr >> 3) & (table->size - 1);
+  while (table->addrs[index] != 0) {
+    if (table->addrs[index] == addr) return table->values[index];
+    index = (index + 1) & (table->size - 1);
+  }
+  
+  return -1;
+}
+
+
+// Keep the table at most three quarters full, as plist.c does.
+static void InsertAddr(AddrTable *table, void *addr, long value)
+{
+  AddrTable newTable;
+  long      cnt, index;
+  
+  if ((table->count + 1) > (table->size / 4 * 3)) {
+    newTable.size = (table->size != 0) ? (table->size * 2) : kAddrTableSize;
+    newTable.count = 0;
+    newTable.addrs = calloc(newTable.size, sizeof(void *));
+    newTable.values = calloc(newTable.size, sizeof(long));
+    if ((newTable.addrs == NULL) || (newTable.values == NULL)) {
+      fprintf(stderr, "%s: out of memory\n", gToolName);
+      exit(-1);
+    }
+    
+    for (cnt = 0; cnt < table->size; cnt++) {
+      if (table->addrs[cnt] != 0) {
+	InsertAddr(&newTable, table->addrs[cnt], table->values[cnt]);
+      }
+    }
+    
+    free(table->addrs);
+    free(table->values);
+    *table = newTable;
+  }
+  
+  index = ((unsigned long)addr >> 3) & (table->size - 1);
+  while (table->addrs[index] != 0) index = (index + 1) & (table->size - 1);
+  
+  table->addrs[index] = addr;
+  table->values[index] = value;
+  table->count++;
+}
+
+
+static void *Grow(void *array, long *size, long count, long elementSize)
+{
+  if (count <= *size) return array;
+  
+  while (*size < count) *size = (*size != 0) ? (*size * 2) : 256;
+  
+  array = realloc(array, *size * elementSize);
+  if (array == NULL) {
+    fprintf(stderr, "%s: out of memory\n", gToolName);
+    exit(-1);
+  }
+  
+  return array;
+}
+
+
+// The index is big endian for the PowerPC.
+static void PutLong(unsigned char *buffer, unsigned long value)
+{
+  buffer[0] = value >> 24;
+  buffer[1] = value >> 16;
+  buffer[2] = value >> 8;
+  buffer[3] = value;
+}
+
+
+// HFS+ keeps names in order without regard to case.  UTF-8 sorts
+// as UTF-16 does outside of the surrogates, which kext names do not
+// use, so only the ASCII letters need folding.
+static int CompareNames(const void *name1, const void *name2)
+{
+  const unsigned char *str1 = *(unsigned char **)name1;
+  const unsigned char *str2 = *(unsigned char **)name2;
+  int                 ch1, ch2;
+  
+  do {
+    ch1 = *str1++;
+    ch2 = *str2++;
+    if ((ch1 >= 'A') && (ch1 <= 'Z')) ch1 += 'a' - 'A';
+    if ((ch2 >= 'A') && (ch2 <= 'Z')) ch2 += 'a' - 'A';
+  } while ((ch1 == ch2) && (ch1 != '\0'));
+  
+  return ch1 - ch2;
+}
@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2000 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ * 
+ * The contents of this file constitute Original Code as defined in and
+ * are subject to the Apple Public Source License Version 1.1 (the
+ * "License").  You may not use this file except in compliance with the
+ * License.  Please obtain a copy of the License at
+ * http://www.apple.com/publicsource and read it before using this file.
+ * 
+ * This Original Code and all software distributed under the License are
+ * distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON-INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * @APPLE_LICENSE_HEADER_END@
+ */
+/*
+ *  adler32-test.c - Checks BootX's Adler-32 against zlib's and
+ *                   times the two.
+ *
+ *  Copyright (c) 2005 Apple Computer, Inc.
+ *
+ *  DRI: Josh de Cesare
+ */
+
+#include <zlib.h>
+
+#include "test.h"
+
+// BootX's adler32.c is built here as it is.  To check the AltiVec
+// path as well, build on a G4 or G5 with CFLAGS="-arch ppc -faltivec".
+#define ADLER32_USER (1)
+#include "../bootx.tproj/sl.subproj/adler32.c"
+
+#define kNumBuffers    (3000)
+#define kMaxLength     (9 << 20)
+#define kNumSums       (100000)
+#define kBenchLength   (16 << 20)
+
+static long TestBuffers(unsigned char *buffer, long altivec);
+static long TestReduce(void);
+static long TestBench(unsigned char *buffer, long passes);
+
+
+int main(int argc, char **argv)
+{
+  unsigned char *buffer;
+  long          passes;
+  
+  passes = GetPasses(&argc, &argv, 20);
+  if ((passes == -1) || (argc != 0)) {
+    fprintf(stderr, "Usage: %s [-n passes]\n", gToolName);
+    return -1;
+  }
+  
+  // Leave room to start the buffers at any offset.
+  buffer = AllocateTestMemory(kBenchLength + 16);
+  
+  if (TestReduce() == -1) return -1;
+  
+  if (TestBuffers(buffer, 0) == -1) return -1;
+#if defined(__VEC__)
+  if (TestBuffers(buffer, 1) == -1) return -1;
+#endif
+  
+  if ((passes != 0) && (TestBench(buffer, passes) == -1)) return -1;
+  
+  free(buffer);
+  
+  return 0;
+}
+
+
+// Sum random buffers with UpdateAdler32 and with zlib, starting from
+// 1 or from the sum of some other bytes.  Some are all 0xFF, which
+// makes s1 and s2 as large as they can be between reductions, and a
+// few are longer than kAdlerBlockSize.
+static long TestBuffers(unsigned char *buffer, long altivec)
+{
+  unsigned char *buf;
+  unsigned long adler, sum, zsum;
+  long          cnt, length, cnt2, mode;
+  
+  gHasAltiVec = altivec;
+  
+  for (cnt = 0; cnt < kNumBuffers; cnt++) {
+    srandom(cnt);
+    if (cnt < 1000) length = random() % 600;
+    else if (cnt < kNumBuffers - 10) length = random() % 200000;
+    else length = kMaxLength - random() % 64;
+    
+    buf = buffer + random() % 16;
+    mode = random() % 3;
+    for (cnt2 = 0; cnt2 < length; cnt2++) {
+      switch (mode) {
+      case 0  : buf[cnt2] = 0xFF; break;
+      case 1  : buf[cnt2] = random(); break;
+      default : buf[cnt2] = random() % 4; break;
+      }
+    }
+    
+    adler = (random() % 2) ? 1 : adler32(0, buffer, random() % 50);
+    
+    sum = UpdateAdler32(adler, buf, length);
+    zsum = adler32(adler, buf, length);
+    if (sum != zsum) {
+      fprintf(stderr, "%s: %s: buffer %ld, %ld bytes: "
+	      "0x%08lx instead of 0x%08lx\n", gToolName,
+	      altivec ? "AltiVec" : "scalar", cnt, length, sum, zsum);
+      return -1;
+    }
+  }
+  
+  printf("%s: %d buffers matched zlib\n",
+	 altivec ? "AltiVec" : "scalar", kNumBuffers);
+  
+  return 0;
+}
+
+
+// Reduce random sums, large and small, and check them with %.
+static long TestReduce(void)
+{
+  unsigned long long sum;
+  long               cnt;
+  
+  srandom(1);
+  
+  for (cnt = 0; cnt < kNumSums; cnt++) {
+    sum = ((unsigned long long)random() << 33) ^
+      ((unsigned long long)random() << 11) ^ random();
+    sum >>= random() % 64;
+    if (cnt < 64) sum = ~0ULL >> cnt;
+    
+    if (ReduceAdler32(sum) != (sum % BASE)) {
+      fprintf(stderr, "%s: ReduceAdler32(0x%llx) is %lu instead of %llu\n",
+	      gToolName, sum, ReduceAdler32(sum), sum % BASE);
+      return -1;
+    }
+  }
+  
+  printf("%d sums reduced correctly\n", kNumSums);
+  
+  return 0;
+}
+
+
+static long TestBench(unsigned char *buffer, long passes)
+{
+  unsigned long sum = 0, zsum = 0;
+  long          cnt;
+  double        start, zlibTime, scalarTime;
+#if defined(__VEC__)
+  double        vectorTime;
+#endif
+  
+  for (cnt = 0; cnt < kBenchLength; cnt++) buffer[cnt] = random();
+  
+  start = GetSeconds();
+  for (cnt = 0; cnt < passes; cnt++) zsum = adler32(1, buffer, kBenchLength);
+  zlibTime = (GetSeconds() - start) / passes;
+  
+  gHasAltiVec = 0;
+  start = GetSeconds();
+  for (cnt = 0; cnt < passes; cnt++) sum = Adler32(buffer, kBenchLength);
+  scalarTime = (GetSeconds() - start) / passes;
+  if (sum != zsum) {
+    fprintf(stderr, "%s: scalar sum is wrong\n", gToolName);
+    return -1;
+  }
+  
+  printf("%d bytes\n", kBenchLength);
+  printf("  zlib    %8.2f ms %7.1f MB/s\n",
+	 zlibTime * 1000.0, kBenchLength / zlibTime / 1000000.0);
+  printf("  scalar  %8.2f ms %7.1f MB/s\n",
+	 scalarTime * 1000.0, kBenchLength / scalarTime / 1000000.0);
+  
+#if defined(__VEC__)
+  gHasAltiVec = 1;
+  start = GetSeconds();
+  for (cnt = 0; cnt < passes; cnt++) sum = Adler32(buffer, kBenchLength);
+  vectorTime = (GetSeconds() - start) / passes;
+  if (sum != zsum) {
+    fprintf(stderr, "%s: AltiVec sum is wrong\n", gToolName);
+    return -1;
+  }
+  
+  printf("  AltiVec %8.2f ms %7.1f MB/s\n",
+	 vectorTime * 1000.0, kBenchLength / vectorTime / 1000000.0);
+#endif
+  
+  return 0;
+}
+
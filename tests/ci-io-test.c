@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2000 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ * 
+ * The contents of this file constitute Original Code as defined in and
+ * are subject to the Apple Public Source License Version 1.1 (the
+ * "License").  You may not use this file except in compliance with the
+ * License.  Please obtain a copy of the License at
+ * http://www.apple.com/publicsource and read it before using this file.
+ * 
+ * This Original Code and all software distributed under the License are
+ * distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON-INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * @APPLE_LICENSE_HEADER_END@
+ */
+/*
+ *  ci-io-test.c - Counts the client interface calls BootX's console
+ *                 output makes for a verbose boot.
+ *
+ *  Copyright (c) 2005 Apple Computer, Inc.
+ *
+ *  DRI: Josh de Cesare
+ */
+
+#include <stdarg.h>
+
+#include "test.h"
+
+// BootX's ci_io.c is built here as it is, with its functions renamed so
+// they do not replace the host's.  Its headers are kept out, and
+// CallMethod is replaced by one that counts the calls and acts like
+// the sl_words package, so that the output can be checked.
+#define _BOOTX_CI_H_
+#define _BOOTX_SL_WORDS_H_
+#define _BOOTX_LIBCLITE_H_
+
+typedef long CICell;
+
+CICell SLWordsIH = 1;
+
+long CallMethod(long args, long rets, CICell iHandle, const char *method, ...);
+
+#define putchar     BootXPutchar
+#define puts        BootXPuts
+#define FlushOutput BootXFlushOutput
+
+void FlushOutput(void);
+
+#include "../bootx.tproj/ci.subproj/ci_io.c"
+
+#undef putchar
+#undef puts
+#undef FlushOutput
+
+#define kTranscriptSize (0x100000)
+#define kNumKexts       (300)
+#define kNumMatched     (60)
+
+static void VerboseBoot(int (*putfn)(int ch), void (*flushfn)(void));
+static void Print(const char *format, ...);
+static void SetOutputLevel(long level);
+static int OldPutchar(int ch);
+static void NoFlush(void);
+static void Emit(char *str, long length);
+
+static int  (*gPutFn)(int ch);
+static void (*gFlushFn)(void);
+
+static long gNumCalls, gNumLineCalls, gNumLines, gNumLevels;
+static long gOutputLevel;
+static char *gTranscript;
+static long gTranscriptLength;
+
+static char *gKextNames[] = {
+  "AppleACPIPlatform", "AppleFileSystemDriver", "AppleGPIO", "AppleI2C",
+  "AppleKeyLargo", "AppleMacRISC4PE", "AppleMPIC", "AppleNVRAM",
+  "AppleRAID", "AppleSMU", "AppleUSBEHCI", "AppleUSBOHCI",
+  "IOATAFamily", "IOGraphicsFamily", "IONDRVSupport", "IONetworkingFamily",
+  "IOPCIFamily", "IOSCSIArchitectureModelFamily", "IOStorageFamily",
+  "IOUSBFamily", "UniNEnet", "BootCache", "System", "AppleFWOHCI"
+};
+#define kNumKextNames (sizeof(gKextNames) / sizeof(char *))
+
+
+int main(int argc, char **argv)
+{
+  char *oldTranscript;
+  long oldCalls, oldLength, lines;
+  
+  if ((GetPasses(&argc, &argv, 0) == -1) || (argc != 0)) {
+    fprintf(stderr, "Usage: %s\n", gToolName);
+    return -1;
+  }
+  
+  oldTranscript = AllocateTestMemory(kTranscriptSize);
+  gTranscript = AllocateTestMemory(kTranscriptSize);
+  
+  // One call per character, as putchar was before.
+  VerboseBoot(OldPutchar, NoFlush);
+  oldCalls = gNumCalls;
+  oldLength = gTranscriptLength;
+  lines = gNumLines;
+  memcpy(oldTranscript, gTranscript, oldLength);
+  
+  // And a line at a time.
+  VerboseBoot(BootXPutchar, BootXFlushOutput);
+  
+  if ((gTranscriptLength != oldLength) ||
+      memcmp(gTranscript, oldTranscript, oldLength)) {
+    fprintf(stderr, "%s: the buffered output is not the same\n", gToolName);
+    return -1;
+  }
+  
+  // Each line should be one call.  The only others set the output
+  // level, write out a partial line before that, or write out a line
+  // longer than the buffer.
+  if ((gNumLineCalls != lines) ||
+      (gNumCalls > lines + gNumLevels * 2 + oldLength / kOutputBufferSize)) {
+    fprintf(stderr, "%s: %ld calls for %ld lines and %ld level changes\n",
+	    gToolName, gNumCalls, lines, gNumLevels);
+    return -1;
+  }
+  
+  printf("%ld lines, %ld bytes shown\n", lines, oldLength);
+  printf("  a call per character %7ld calls\n", oldCalls);
+  printf("  a call per line      %7ld calls\n", gNumCalls);
+  
+  return 0;
+}
+
+
+// Print what a verbose boot from an Extensions folder prints, with
+// some of it at an output level that hides it.
+static void VerboseBoot(int (*putfn)(int ch), void (*flushfn)(void))
+{
+  long cnt;
+  char *name, path[512];
+  
+  gPutFn = putfn;
+  gFlushFn = flushfn;
+  gNumCalls = gNumLineCalls = gNumLines = gNumLevels = 0;
+  gTranscriptLength = 0;
+  gOutputLevel = 0;
+  
+  Print("\n\nMac OS X Loader\n");
+  SetOutputLevel(2);
+  
+  Print("Opening partition [%s]...\n", "/pci@f4000000/ata-6@d/disk@0:3");
+  Print("%s HFS%s file: [%s] from %x.\n", "Loading", "+",
+	"\\\\:tbxi", 0xff9a5ac0);
+  Print("%s HFS%s file: [%s] from %x.\n", "Loading", "+",
+	"\\System\\Library\\Extensions.mkext", 0xff9a5ac0);
+  
+  Print("FileLoadDrivers: Loading from [%s]\n",
+	"hd:3,\\System\\Library\\Extensions");
+  for (cnt = 0; cnt < kNumKexts; cnt++) {
+    name = gKextNames[cnt % kNumKextNames];
+    sprintf(path, "\\System\\Library\\Extensions\\%s%ld.kext\\Contents"
+	    "\\Info.plist", name, cnt / kNumKextNames);
+    Print("%s HFS%s file: [%s] from %x.\n", "Loading", "+",
+	  path, 0xff9a5ac0);
+  }
+  
+  // A line longer than the buffer.
+  Print("%s HFS%s file: [", "Loading", "+");
+  for (cnt = 0; cnt < 40; cnt++) Print("\\Deeper%ld", cnt);
+  Print("] from %x.\n", 0xff9a5ac0);
+  
+  // A partial line is still shown at the level it was printed at.
+  Print("Matching");
+  SetOutputLevel(0);
+  Print(" hidden\n");
+  SetOutputLevel(2);
+  
+  for (cnt = 0; cnt < kNumMatched; cnt++) {
+    name = gKextNames[cnt % kNumKextNames];
+    sprintf(path, "\\System\\Library\\Extensions\\%s%ld.kext\\Contents"
+	    "\\MacOS\\%s", name, cnt / kNumKextNames, name);
+    Print("%s HFS%s file: [%s] from %x.\n", "Loading", "+",
+	  path, 0xff9a5ac0);
+  }
+  
+  Print("%s HFS%s file: [%s] from %x.\n", "Reading", "+",
+	"\\mach_kernel", 0xff9a5ac0);
+  Print("\nCall Kernel!\n");
+  
+  // What Quiesce does before the kernel takes over.
+  gFlushFn();
+}
+
+
+// libclite's printf hands each character to putchar in turn.
+static void Print(const char *format, ...)
+{
+  va_list ap;
+  char    buffer[1024], *str;
+  
+  va_start(ap, format);
+  vsnprintf(buffer, sizeof(buffer), format, ap);
+  va_end(ap);
+  
+  for (str = buffer; *str != '\0'; str++) {
+    if (*str == '\n') gNumLines++;
+    gPutFn(*str);
+  }
+}
+
+
+// As SetOutputLevel in sl_words.c does.
+static void SetOutputLevel(long level)
+{
+  gFlushFn();
+  CallMethod(1, 0, SLWordsIH, "slw_set_output_level", level);
+  gNumLevels++;
+}
+
+
+// putchar as it was before it buffered lines.
+static int OldPutchar(int ch)
+{
+  if ((ch == '\r') || (ch == '\n')) CallMethod(0, 0, SLWordsIH, "slw_cr");
+  else CallMethod(1, 0, SLWordsIH, "slw_emit", ch);
+  
+  return ch;
+}
+
+
+static void NoFlush(void)
+{
+}
+
+
+// Count the call, and do what the sl_words method would.
+long CallMethod(long args, long rets, CICell iHandle, const char *method, ...)
+{
+  va_list ap;
+  char    ch, *addr;
+  long    length;
+  
+  gNumCalls++;
+  
+  va_start(ap, method);
+  
+  if (!strcmp(method, "slw_set_output_level")) {
+    gOutputLevel = va_arg(ap, long);
+  } else if (!strcmp(method, "slw_emit")) {
+    ch = va_arg(ap, int);
+    if (gOutputLevel >= 2) Emit(&ch, 1);
+  } else if (!strcmp(method, "slw_cr")) {
+    if (gOutputLevel >= 2) Emit("\n", 1);
+  } else if (!strcmp(method, "slw_type")) {
+    addr = va_arg(ap, char *);
+    length = va_arg(ap, long);
+    if (gOutputLevel >= 2) Emit(addr, length);
+  } else if (!strcmp(method, "slw_type_cr")) {
+    addr = va_arg(ap, char *);
+    length = va_arg(ap, long);
+    if (gOutputLevel >= 2) {
+      Emit(addr, length);
+      Emit("\n", 1);
+    }
+    gNumLineCalls++;
+  } else {
+    fprintf(stderr, "%s: unknown method %s\n", gToolName, method);
+    exit(-1);
+  }
+  
+  va_end(ap);
+  
+  return 0;
+}
+
+
+static void Emit(char *str, long length)
+{
+  if ((gTranscriptLength + length) > kTranscriptSize) {
+    fprintf(stderr, "%s: the transcript is too long\n", gToolName);
+    exit(-1);
+  }
+  
+  memcpy(gTranscript + gTranscriptLength, str, length);
+  gTranscriptLength += length;
+}
@@ -0,0 +1,627 @@
+/*
+ * Copyright (c) 2000 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ * 
+ * The contents of this file constitute Original Code as defined in and
+ * are subject to the Apple Public Source License Version 1.1 (the
+ * "License").  You may not use this file except in compliance with the
+ * License.  Please obtain a copy of the License at
+ * http://www.apple.com/publicsource and read it before using this file.
+ * 
+ * This Original Code and all software distributed under the License are
+ * distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON-INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * @APPLE_LICENSE_HEADER_END@
+ */
+/*
+ *  lzss-test.c - Checks BootX's LZSS decoder and the Adler-32 it keeps
+ *                against the reference decoder, and times them.
+ *
+ *  Copyright (c) 2005 Apple Computer, Inc.
+ *
+ *  DRI: Josh de Cesare
+ */
+
+#include "test.h"
+
+// BootX's lzss.c and adler32.c are built here as they are.
+#define ADLER32_USER (1)
+#include "../bootx.tproj/sl.subproj/adler32.c"
+#include "../bootx.tproj/sl.subproj/lzss.c"
+
+#define kNumStreams    (2000)
+#define kMaxStreamSize (0x10000)
+#define kMaxOutputSize (kMaxStreamSize / 2 * (F + 1))
+#define kGuardSize     (16)
+#define kSampleSize    (0x400000)
+
+static long TestStreams(void);
+static long MakeStream(u_int8_t *src, long mode, long size);
+static long CanCopy(long t, long i, long j);
+static long TestFile(char *fileName, long passes);
+static long TestChunks(u_int8_t *src, long srcLength, u_int8_t *data,
+		       long length, u_int32_t adler32);
+static void TimeDecoders(u_int8_t *src, long srcLength, u_int8_t *out,
+			 long length, long passes);
+static u_int8_t *MakeSample(long *length);
+static long CheckOutput(char *what, u_int8_t *out, long length,
+			u_int8_t *expected, long expectedLength);
+static int ReferenceDecompress(u_int8_t *dst, u_int8_t *src,
+			       u_int32_t srclen);
+static u_int32_t ReferenceAdler32(u_int8_t *buf, long len);
+static long Compress(u_int8_t *dst, u_int8_t *src, long srclen);
+static void InitTree(void);
+static void InsertNode(int r);
+static void DeleteNode(int p);
+
+// State for Compress.
+static u_int8_t gTextBuf[N + F - 1];
+static int      gMatchPosition, gMatchLength;
+static int      gLSon[N + 1], gRSon[N + 257], gDad[N + 1];
+
+
+int main(int argc, char **argv)
+{
+  long passes;
+  
+  passes = GetPasses(&argc, &argv, 20);
+  if (passes == -1) {
+    fprintf(stderr, "Usage: %s [-n passes] [file ...]\n", gToolName);
+    return -1;
+  }
+  
+  if (TestStreams() == -1) return -1;
+  
+  // Without files, use a made up sample.
+  if (argc == 0) return TestFile(0, passes);
+  
+  for ( ; argc > 0; argv++, argc--) {
+    if (TestFile(*argv, passes) == -1) return -1;
+  }
+  
+  return 0;
+}
+
+
+// Decode random streams with both decoders.  The streams have matches
+// the encoder would seldom make: into the spaces the ring starts with,
+// a full ring back, and overlapping the bytes they write.  Some are cut
+// off in the middle of a group or a match.
+static long TestStreams(void)
+{
+  u_int8_t *src, *out, *ref;
+  long     cnt, srcLength, outLength, refLength;
+  char     what[64];
+  
+  src = AllocateTestMemory(kMaxStreamSize);
+  out = AllocateTestMemory(kMaxOutputSize + kGuardSize);
+  ref = AllocateTestMemory(kMaxOutputSize + kGuardSize);
+  
+  for (cnt = 0; cnt < kNumStreams; cnt++) {
+    srandom(cnt);
+    srcLength = MakeStream(src, cnt % 4,
+			   random() % ((cnt < kNumStreams / 2) ?
+				       0x1000 : kMaxStreamSize));
+    
+    refLength = ReferenceDecompress(ref, src, srcLength);
+    
+    memset(out, 0xAA, kMaxOutputSize + kGuardSize);
+    outLength = decompress_lzss(out, src, srcLength);
+    
+    sprintf(what, "stream %ld", cnt);
+    if (CheckOutput(what, out, outLength, ref, refLength) == -1) return -1;
+  }
+  
+  printf("%d random streams decoded the same\n", kNumStreams);
+  
+  free(src);
+  free(out);
+  free(ref);
+  
+  return 0;
+}
+
+
+static long MakeStream(u_int8_t *src, long mode, long size)
+{
+  long     t, i, j, k, bit, flags, dist;
+  u_int8_t *start = src, *end = src + size, *flagsPtr;
+  
+  // Stop short of a whole group so the stream can be cut anywhere.
+  t = 0;
+  while ((end - src) >= (1 + 8 * 2)) {
+    flagsPtr = src++;
+    flags = 0;
+    
+    for (bit = 0; bit < 8; bit++) {
+      if ((random() % 4) < mode) {
+	// Try a few places before settling for a literal.
+	for (k = 0; k < 4; k++) {
+	  switch (random() % 4) {
+	  case 0  : dist = 1 + random() % 8; break;
+	  case 1  : dist = N - random() % 4; break;
+	  case 2  : dist = t + 1 + random() % (N - F); break;
+	  default : dist = 1 + random() % N; break;
+	  }
+	  i = (N - F + t - dist) & (N - 1);
+	  j = random() % (F - THRESHOLD);
+	  if (CanCopy(t, i, j + THRESHOLD + 1)) break;
+	}
+	if (k < 4) {
+	  *src++ = i;
+	  *src++ = ((i >> 4) & 0xF0) | j;
+	  t += j + THRESHOLD + 1;
+	  continue;
+	}
+      }
+      
+      flags |= 1 << bit;
+      *src++ = (mode == 0) ? random() : " ab\n"[random() % 4];
+      t++;
+    }
+    
+    *flagsPtr = flags;
+  }
+  
+  // Cut the stream off, maybe in the middle of a match.
+  if ((random() % 2) && (src > start)) src -= random() % 3;
+  
+  return src - start;
+}
+
+
+// Whether the reference decoder has written each byte it would read
+// for a match of j bytes at ring position i, after t bytes of output.
+static long CanCopy(long t, long i, long j)
+{
+  long k, p;
+  
+  for (k = 0; k < j; k++) {
+    p = (i + k) & (N - 1);
+    if ((p >= (N - F)) && ((p - (N - F)) >= (t + k))) return 0;
+  }
+  
+  return 1;
+}
+
+
+// Compress the file with the reference encoder, check that both
+// decoders give it back, and check the checksum the decoder keeps,
+// when fed all at once and in chunks.  Then time them.
+static long TestFile(char *fileName, long passes)
+{
+  u_int8_t  *data, *src, *out;
+  long      length, srcLength, outLength;
+  u_int32_t adler32, fusedAdler32;
+  
+  if (fileName != 0) data = ReadFile(fileName, &length);
+  else {
+    data = MakeSample(&length);
+    fileName = "sample";
+  }
+  if (data == NULL) return -1;
+  
+  src = AllocateTestMemory(length / 8 * 9 + 9);
+  out = AllocateTestMemory(length + kGuardSize);
+  
+  srcLength = Compress(src, data, length);
+  adler32 = ReferenceAdler32(data, length);
+  
+  memset(out, 0xAA, length + kGuardSize);
+  outLength = ReferenceDecompress(out, src, srcLength);
+  if (CheckOutput("reference", out, outLength, data, length) == -1) {
+    return -1;
+  }
+  
+  memset(out, 0xAA, length + kGuardSize);
+  outLength = decompress_lzss(out, src, srcLength);
+  if (CheckOutput("decompress_lzss", out, outLength, data, length) == -1) {
+    return -1;
+  }
+  
+  memset(out, 0xAA, length + kGuardSize);
+  outLength = decompress_lzss_adler32(out, src, srcLength, &fusedAdler32);
+  if (CheckOutput("decompress_lzss_adler32", out, outLength,
+		  data, length) == -1) {
+    return -1;
+  }
+  if ((fusedAdler32 != adler32) || (Adler32(data, length) != adler32)) {
+    fprintf(stderr, "%s: %s: Adler-32 is 0x%08x and 0x%08lx "
+	    "instead of 0x%08x\n", gToolName, fileName, fusedAdler32,
+	    Adler32(data, length), adler32);
+    return -1;
+  }
+  
+  if (TestChunks(src, srcLength, data, length, adler32) == -1) return -1;
+  
+  printf("%s: %ld bytes, compressed to %ld, decoded the same\n",
+	 fileName, length, srcLength);
+  
+  if (passes != 0) TimeDecoders(src, srcLength, out, length, passes);
+  
+  free(data);
+  free(src);
+  free(out);
+  
+  return 0;
+}
+
+
+// Time the decoders, and the checksum the decoder keeps against
+// decoding and checksumming in two passes.
+static void TimeDecoders(u_int8_t *src, long srcLength, u_int8_t *out,
+			 long length, long passes)
+{
+  long      pass, outLength;
+  u_int32_t fusedAdler32;
+  double    start, refTime, newTime, twoPassTime, fusedTime;
+  
+  start = GetSeconds();
+  for (pass = 0; pass < passes; pass++) {
+    ReferenceDecompress(out, src, srcLength);
+  }
+  refTime = (GetSeconds() - start) / passes;
+  
+  start = GetSeconds();
+  for (pass = 0; pass < passes; pass++) {
+    decompress_lzss(out, src, srcLength);
+  }
+  newTime = (GetSeconds() - start) / passes;
+  
+  // What DecodeKernel did before the checksum moved into the decoder.
+  start = GetSeconds();
+  for (pass = 0; pass < passes; pass++) {
+    outLength = decompress_lzss(out, src, srcLength);
+    Adler32(out, outLength);
+  }
+  twoPassTime = (GetSeconds() - start) / passes;
+  
+  start = GetSeconds();
+  for (pass = 0; pass < passes; pass++) {
+    decompress_lzss_adler32(out, src, srcLength, &fusedAdler32);
+  }
+  fusedTime = (GetSeconds() - start) / passes;
+  
+  printf("  reference               %8.2f ms %7.1f MB/s\n",
+	 refTime * 1000.0, length / refTime / 1000000.0);
+  printf("  decompress_lzss         %8.2f ms %7.1f MB/s\n",
+	 newTime * 1000.0, length / newTime / 1000000.0);
+  printf("  then Adler32            %8.2f ms %7.1f MB/s\n",
+	 twoPassTime * 1000.0, length / twoPassTime / 1000000.0);
+  printf("  decompress_lzss_adler32 %8.2f ms %7.1f MB/s\n",
+	 fusedTime * 1000.0, length / fusedTime / 1000000.0);
+}
+
+
+// Feed the decoder the way LoadKernelCache does: each chunk goes in
+// behind what the last call left over.
+static long TestChunks(u_int8_t *src, long srcLength, u_int8_t *data,
+		       long length, u_int32_t adler32)
+{
+  static long chunkSizes[] = { 17, 18, 19, 100, 4096, 65537, 0x100000, 0 };
+  lzss_stream stream;
+  u_int8_t    *buffer, *out;
+  long        cnt, chunkSize, used, left, size, offset;
+  char        what[64];
+  
+  out = AllocateTestMemory(length + kGuardSize);
+  buffer = AllocateTestMemory(0x100000 + F * 2);
+  
+  for (cnt = 0; chunkSizes[cnt] != 0; cnt++) {
+    chunkSize = chunkSizes[cnt];
+    memset(out, 0xAA, length + kGuardSize);
+    decompress_lzss_start(&stream, out, 1);
+    
+    left = 0;
+    for (offset = 0; offset < srcLength; offset += size) {
+      size = srcLength - offset;
+      if (size > chunkSize) size = chunkSize;
+      memcpy(buffer + left, src + offset, size);
+      left += size;
+      
+      used = decompress_lzss_chunk(&stream, buffer, left,
+				   (offset + size) == srcLength);
+      left -= used;
+      memmove(buffer, buffer + used, left);
+    }
+    
+    sprintf(what, "%ld byte chunks", chunkSize);
+    if (CheckOutput(what, out, stream.dst - out, data, length) == -1) {
+      return -1;
+    }
+    if (stream.adler32 != adler32) {
+      fprintf(stderr, "%s: %s: Adler-32 is 0x%08x instead of 0x%08x\n",
+	      gToolName, what, stream.adler32, adler32);
+      return -1;
+    }
+  }
+  
+  free(out);
+  free(buffer);
+  
+  return 0;
+}
+
+
+// Something that compresses about as well as a kernel: words from a
+// small set, runs of zeros and the odd random word.
+static u_int8_t *MakeSample(long *length)
+{
+  u_int32_t *words, pool[256];
+  long      cnt, run;
+  
+  words = AllocateTestMemory(kSampleSize);
+  
+  srandom(1);
+  for (cnt = 0; cnt < 256; cnt++) pool[cnt] = random();
+  
+  for (cnt = 0; cnt < kSampleSize / 4; ) {
+    switch (random() % 8) {
+    case 0 :
+      for (run = random() % 64; (run > 0) && (cnt < kSampleSize / 4); run--)
+	words[cnt++] = 0;
+      break;
+    
+    case 1 :
+      words[cnt++] = random();
+      break;
+    
+    default :
+      words[cnt++] = pool[random() % 256];
+      break;
+    }
+  }
+  
+  *length = kSampleSize;
+  return (u_int8_t *)words;
+}
+
+
+static long CheckOutput(char *what, u_int8_t *out, long length,
+			u_int8_t *expected, long expectedLength)
+{
+  long cnt;
+  
+  if (length != expectedLength) {
+    fprintf(stderr, "%s: %s: %ld bytes instead of %ld\n",
+	    gToolName, what, length, expectedLength);
+    return -1;
+  }
+  
+  for (cnt = 0; cnt < length; cnt++) {
+    if (out[cnt] != expected[cnt]) {
+      fprintf(stderr, "%s: %s: byte %ld is 0x%02x instead of 0x%02x\n",
+	      gToolName, what, cnt, out[cnt], expected[cnt]);
+      return -1;
+    }
+  }
+  
+  for (cnt = 0; cnt < kGuardSize; cnt++) {
+    if (out[length + cnt] != 0xAA) {
+      fprintf(stderr, "%s: %s: wrote past the end\n", gToolName, what);
+      return -1;
+    }
+  }
+  
+  return 0;
+}
+
+
+// Adler-32 a byte at a time, as zlib defines it.
+static u_int32_t ReferenceAdler32(u_int8_t *buf, long len)
+{
+  u_int32_t s1 = 1, s2 = 0;
+  
+  while (len-- > 0) {
+    s1 = (s1 + *buf++) % 65521;
+    s2 = (s2 + s1) % 65521;
+  }
+  
+  return (s2 << 16) | s1;
+}
+
+
+// The decoder as it was in lzss.c before it wrote straight into the
+// output, from Haruhiko Okumura's LZSS.C.
+static int ReferenceDecompress(u_int8_t *dst, u_int8_t *src,
+			       u_int32_t srclen)
+{
+  /* ring buffer of size N, with extra F-1 bytes to aid string comparison */
+  u_int8_t text_buf[N + F - 1];
+  u_int8_t *dststart = dst;
+  u_int8_t *srcend = src + srclen;
+  int  i, j, k, r, c;
+  unsigned int flags;
+  
+  dst = dststart;
+  srcend = src + srclen;
+  for (i = 0; i < N - F; i++)
+    text_buf[i] = ' ';
+  r = N - F;
+  flags = 0;
+  for ( ; ; ) {
+    if (((flags >>= 1) & 0x100) == 0) {
+      if (src < srcend) c = *src++; else break;
+      flags = c | 0xFF00;  /* uses higher byte cleverly */
+    }   /* to count eight */
+    if (flags & 1) {
+      if (src < srcend) c = *src++; else break;
+      *dst++ = c;
+      text_buf[r++] = c;
+      r &= (N - 1);
+    } else {
+      if (src < srcend) i = *src++; else break;
+      if (src < srcend) j = *src++; else break;
+      i |= ((j & 0xF0) << 4);
+      j  =  (j & 0x0F) + THRESHOLD;
+      for (k = 0; k <= j; k++) {
+	c = text_buf[(i + k) & (N - 1)];
+	*dst++ = c;
+	text_buf[r++] = c;
+	r &= (N - 1);
+      }
+    }
+  }
+  
+  return dst - dststart;
+}
+
+
+// The encoder from LZSS.C, which is what kextcache uses to compress
+// the kernelcache.  It finds the longest match with binary trees.
+static long Compress(u_int8_t *dst, u_int8_t *src, long srclen)
+{
+  u_int8_t *dststart = dst, *srcend = src + srclen;
+  u_int8_t code_buf[17], mask;
+  int      i, c, len, r, s, last_match_length, code_buf_ptr;
+  
+  InitTree();
+  code_buf[0] = 0;
+  code_buf_ptr = mask = 1;
+  s = 0;
+  r = N - F;
+  
+  for (i = s; i < r; i++) gTextBuf[i] = ' ';
+  for (len = 0; (len < F) && (src < srcend); len++) gTextBuf[r + len] = *src++;
+  if (len == 0) return 0;
+  
+  for (i = 1; i <= F; i++) InsertNode(r - i);
+  InsertNode(r);
+  
+  do {
+    if (gMatchLength > len) gMatchLength = len;
+    if (gMatchLength <= THRESHOLD) {
+      gMatchLength = 1;
+      code_buf[0] |= mask;
+      code_buf[code_buf_ptr++] = gTextBuf[r];
+    } else {
+      code_buf[code_buf_ptr++] = gMatchPosition;
+      code_buf[code_buf_ptr++] = ((gMatchPosition >> 4) & 0xF0) |
+	(gMatchLength - (THRESHOLD + 1));
+    }
+    
+    if ((mask <<= 1) == 0) {
+      for (i = 0; i < code_buf_ptr; i++) *dst++ = code_buf[i];
+      code_buf[0] = 0;
+      code_buf_ptr = mask = 1;
+    }
+    
+    last_match_length = gMatchLength;
+    for (i = 0; (i < last_match_length) && (src < srcend); i++) {
+      c = *src++;
+      DeleteNode(s);
+      gTextBuf[s] = c;
+      if (s < F - 1) gTextBuf[s + N] = c;
+      s = (s + 1) & (N - 1);
+      r = (r + 1) & (N - 1);
+      InsertNode(r);
+    }
+    while (i++ < last_match_length) {
+      DeleteNode(s);
+      s = (s + 1) & (N - 1);
+      r = (r + 1) & (N - 1);
+      if (--len) InsertNode(r);
+    }
+  } while (len > 0);
+  
+  if (code_buf_ptr > 1) {
+    for (i = 0; i < code_buf_ptr; i++) *dst++ = code_buf[i];
+  }
+  
+  return dst - dststart;
+}
+
+
+static void InitTree(void)
+{
+  int i;
+  
+  for (i = N + 1; i <= N + 256; i++) gRSon[i] = NIL;
+  for (i = 0; i < N; i++) gDad[i] = NIL;
+}
+
+
+// Insert the string at ring position r into the trees, and leave the
+// longest match for it in gMatchPosition and gMatchLength.
+static void InsertNode(int r)
+{
+  int      i, p, cmp;
+  u_int8_t *key;
+  
+  cmp = 1;
+  key = &gTextBuf[r];
+  p = N + 1 + key[0];
+  gRSon[r] = gLSon[r] = NIL;
+  gMatchLength = 0;
+  
+  for ( ; ; ) {
+    if (cmp >= 0) {
+      if (gRSon[p] != NIL) p = gRSon[p];
+      else {
+	gRSon[p] = r;
+	gDad[r] = p;
+	return;
+      }
+    } else {
+      if (gLSon[p] != NIL) p = gLSon[p];
+      else {
+	gLSon[p] = r;
+	gDad[r] = p;
+	return;
+      }
+    }
+    
+    for (i = 1; i < F; i++) {
+      if ((cmp = key[i] - gTextBuf[p + i]) != 0) break;
+    }
+    if (i > gMatchLength) {
+      gMatchPosition = p;
+      if ((gMatchLength = i) >= F) break;
+    }
+  }
+  
+  // Replace p with r, since r is the same and newer.
+  gDad[r] = gDad[p];
+  gLSon[r] = gLSon[p];
+  gRSon[r] = gRSon[p];
+  gDad[gLSon[p]] = r;
+  gDad[gRSon[p]] = r;
+  if (gRSon[gDad[p]] == p) gRSon[gDad[p]] = r;
+  else gLSon[gDad[p]] = r;
+  gDad[p] = NIL;
+}
+
+
+static void DeleteNode(int p)
+{
+  int q;
+  
+  if (gDad[p] == NIL) return;
+  
+  if (gRSon[p] == NIL) q = gLSon[p];
+  else if (gLSon[p] == NIL) q = gRSon[p];
+  else {
+    q = gLSon[p];
+    if (gRSon[q] != NIL) {
+      do q = gRSon[q]; while (gRSon[q] != NIL);
+      gRSon[gDad[q]] = gLSon[q];
+      gDad[gLSon[q]] = gDad[q];
+      gLSon[q] = gLSon[p];
+      gDad[gLSon[p]] = q;
+    }
+    gRSon[q] = gRSon[p];
+    gDad[gRSon[p]] = q;
+  }
+  
+  gDad[q] = gDad[p];
+  if (gRSon[gDad[p]] == p) gRSon[gDad[p]] = q;
+  else gLSon[gDad[p]] = q;
+  gDad[p] = NIL;
+}
+
@@ -0,0 +1,383 @@
+/*
+ * Copyright (c) 2000 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ * 
+ * The contents of this file constitute Original Code as defined in and
+ * are subject to the Apple Public Source License Version 1.1 (the
+ * "License").  You may not use this file except in compliance with the
+ * License.  Please obtain a copy of the License at
+ * http://www.apple.com/publicsource and read it before using this file.
+ * 
+ * This Original Code and all software distributed under the License are
+ * distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON-INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * @APPLE_LICENSE_HEADER_END@
+ */
+/*
+ *  mem-test.c - Checks BootX's memory functions at every alignment
+ *               and overlap, and times them against the byte loops
+ *               they replaced.
+ *
+ *  Copyright (c) 2005 Apple Computer, Inc.
+ *
+ *  DRI: Josh de Cesare
+ */
+
+#include "test.h"
+
+// BootX's mem.c is built here as it is, with its functions renamed so
+// they do not replace the host's.  Its headers are kept out.  The
+// Makefile turns off gcc's loop distribution where it can, so that
+// the byte loops are not made into calls to the host's functions.
+#define _BOOTX_LIBCLITE_H_
+#define _BOOTX_CI_H_
+
+#define memcpy  BootXMemcpy
+#define memmove BootXMemmove
+#define memset  BootXMemset
+#define memcmp  BootXMemcmp
+#define bcopy   BootXBcopy
+#define bzero   BootXBzero
+
+void *memcpy(void *dst, const void *src, size_t len);
+
+#include "../bootx.tproj/libclite.subproj/mem.c"
+
+#undef memcpy
+#undef memmove
+#undef memset
+#undef memcmp
+#undef bcopy
+#undef bzero
+
+#define kTestSize    (4096)
+#define kTestBase    (1024)
+#define kMaxOverlap  (70)
+#define kBenchSize   (4 << 20)
+
+static long TestCopy(void);
+static long TestMove(void);
+static long TestSet(void);
+static long TestCompare(void);
+static long NextLength(long length);
+static long Fail(char *name, long dstAlign, long srcAlign,
+		 long length, long overlap);
+static void TestBench(long passes);
+static void *OldMemcpy(void *dst, const void *src, size_t len);
+static void *OldMemset(void *dst, int ch, size_t len);
+static int OldMemcmp(const void *b1, const void *b2, size_t len);
+static long Sign(long value);
+
+static unsigned char gSource[kTestSize];
+static unsigned char gBuffer[kTestSize];
+static unsigned char gExpected[kTestSize];
+
+// Keeps the compiler from dropping calls whose results are not used.
+static volatile long gSink;
+
+
+int main(int argc, char **argv)
+{
+  long cnt, passes;
+  
+  passes = GetPasses(&argc, &argv, 20);
+  if ((passes == -1) || (argc != 0)) {
+    fprintf(stderr, "Usage: %s [-n passes]\n", gToolName);
+    return -1;
+  }
+  
+  srandom(1);
+  for (cnt = 0; cnt < kTestSize; cnt++) gSource[cnt] = random();
+  
+  if (TestCopy() == -1) return -1;
+  if (TestMove() == -1) return -1;
+  if (TestSet() == -1) return -1;
+  if (TestCompare() == -1) return -1;
+  
+  printf("memcpy, memmove, bcopy, memset, bzero and memcmp are correct\n");
+  
+  if (passes != 0) TestBench(passes);
+  
+  return 0;
+}
+
+
+// Copy between every pair of alignments, into a buffer of 0xAA so
+// that a write past either end shows.
+static long TestCopy(void)
+{
+  long dstAlign, srcAlign, length;
+  void *ret;
+  
+  for (dstAlign = 0; dstAlign < 8; dstAlign++) {
+    for (srcAlign = 0; srcAlign < 8; srcAlign++) {
+      for (length = 0; length < 2048; length = NextLength(length)) {
+	memset(gBuffer, 0xAA, kTestSize);
+	memset(gExpected, 0xAA, kTestSize);
+	memcpy(gExpected + 8 + dstAlign, gSource + srcAlign, length);
+	
+	ret = BootXMemcpy(gBuffer + 8 + dstAlign, gSource + srcAlign, length);
+	if ((ret != (gBuffer + 8 + dstAlign)) ||
+	    memcmp(gBuffer, gExpected, kTestSize)) {
+	  return Fail("memcpy", dstAlign, srcAlign, length, 0);
+	}
+      }
+    }
+  }
+  
+  return 0;
+}
+
+
+// Move within one buffer, from every alignment, to from kMaxOverlap
+// bytes below the source to kMaxOverlap bytes above it.  That covers
+// every destination alignment, overlap at both ends, and distances of
+// less than a word.
+static long TestMove(void)
+{
+  long srcAlign, length, overlap;
+  unsigned char *src, *dst;
+  void *ret;
+  
+  for (srcAlign = 0; srcAlign < 8; srcAlign++) {
+    for (length = 0; length < 600; length = NextLength(length)) {
+      for (overlap = -kMaxOverlap; overlap <= kMaxOverlap; overlap++) {
+	src = gBuffer + kTestBase + srcAlign;
+	dst = src + overlap;
+	
+	memcpy(gExpected, gSource, kTestSize);
+	memmove(gExpected + (dst - gBuffer), gExpected + (src - gBuffer),
+		length);
+	
+	memcpy(gBuffer, gSource, kTestSize);
+	ret = BootXMemmove(dst, src, length);
+	if ((ret != dst) || memcmp(gBuffer, gExpected, kTestSize)) {
+	  return Fail("memmove", (long)dst & 7, srcAlign, length, overlap);
+	}
+	
+	memcpy(gBuffer, gSource, kTestSize);
+	BootXBcopy(src, dst, length);
+	if (memcmp(gBuffer, gExpected, kTestSize)) {
+	  return Fail("bcopy", (long)dst & 7, srcAlign, length, overlap);
+	}
+      }
+    }
+  }
+  
+  return 0;
+}
+
+
+// Fill with zero, which takes the dcbz path on PowerPC, and with
+// other bytes.
+static long TestSet(void)
+{
+  long dstAlign, length, ch;
+  void *ret;
+  
+  for (dstAlign = 0; dstAlign < 8; dstAlign++) {
+    for (length = 0; length < 3000; length = NextLength(length)) {
+      for (ch = 0; ch < 0x300; ch += 0xA5) {
+	memset(gBuffer, 0xAA, kTestSize);
+	memset(gExpected, 0xAA, kTestSize);
+	memset(gExpected + 8 + dstAlign, ch, length);
+	
+	ret = BootXMemset(gBuffer + 8 + dstAlign, ch, length);
+	if ((ret != (gBuffer + 8 + dstAlign)) ||
+	    memcmp(gBuffer, gExpected, kTestSize)) {
+	  return Fail("memset", dstAlign, ch, length, 0);
+	}
+      }
+      
+      memset(gBuffer, 0xAA, kTestSize);
+      memset(gExpected, 0xAA, kTestSize);
+      memset(gExpected + 8 + dstAlign, 0, length);
+      
+      BootXBzero(gBuffer + 8 + dstAlign, length);
+      if (memcmp(gBuffer, gExpected, kTestSize)) {
+	return Fail("bzero", dstAlign, 0, length, 0);
+      }
+    }
+  }
+  
+  return 0;
+}
+
+
+// Compare equal buffers, and buffers that differ in one byte, up or
+// down, at the start, the end and in between.
+static long TestCompare(void)
+{
+  long dstAlign, srcAlign, length, pos, delta;
+  
+  for (dstAlign = 0; dstAlign < 8; dstAlign++) {
+    for (srcAlign = 0; srcAlign < 8; srcAlign++) {
+      for (length = 0; length < 600; length = NextLength(length)) {
+	memcpy(gBuffer + dstAlign, gSource + srcAlign, length);
+	if (BootXMemcmp(gBuffer + dstAlign, gSource + srcAlign, length) != 0) {
+	  return Fail("memcmp", dstAlign, srcAlign, length, 0);
+	}
+	
+	for (pos = 0; pos < length; pos = NextLength(pos)) {
+	  for (delta = -1; delta <= 1; delta += 2) {
+	    memcpy(gBuffer + dstAlign, gSource + srcAlign, length);
+	    gBuffer[dstAlign + pos] += delta;
+	    
+	    if (Sign(BootXMemcmp(gBuffer + dstAlign, gSource + srcAlign,
+				 length)) !=
+		Sign(memcmp(gBuffer + dstAlign, gSource + srcAlign, length))) {
+	      return Fail("memcmp", dstAlign, srcAlign, length, pos);
+	    }
+	  }
+	}
+      }
+    }
+  }
+  
+  return 0;
+}
+
+
+// Every length up to 80, then every 37th.
+static long NextLength(long length)
+{
+  return length + ((length < 80) ? 1 : 37);
+}
+
+
+static long Fail(char *name, long dstAlign, long srcAlign,
+		 long length, long overlap)
+{
+  fprintf(stderr, "%s: %s failed: alignments %ld and %ld, "
+	  "length %ld, offset %ld\n", gToolName, name,
+	  dstAlign, srcAlign, length, overlap);
+  
+  return -1;
+}
+
+
+static void TestBench(long passes)
+{
+  unsigned char *src, *dst;
+  long          cnt, pass;
+  double        start, oldTime, newTime;
+  
+  src = AllocateTestMemory(kBenchSize + 64);
+  dst = AllocateTestMemory(kBenchSize + 64);
+  
+  for (cnt = 0; cnt < kBenchSize + 64; cnt++) src[cnt] = random();
+  
+  printf("%d bytes      old ms   new ms\n", kBenchSize);
+  
+#define BENCH(name, oldCall, newCall)				\
+  start = GetSeconds();						\
+  for (pass = 0; pass < passes; pass++) gSink += (long)oldCall;	\
+  oldTime = (GetSeconds() - start) / passes;			\
+  start = GetSeconds();						\
+  for (pass = 0; pass < passes; pass++) gSink += (long)newCall;	\
+  newTime = (GetSeconds() - start) / passes;			\
+  printf("  %-16s %8.2f %8.2f\n", name, oldTime * 1000.0, newTime * 1000.0);
+  
+  BENCH("memcpy",
+	OldMemcpy(dst, src, kBenchSize),
+	BootXMemcpy(dst, src, kBenchSize));
+  BENCH("memcpy src+1",
+	OldMemcpy(dst, src + 1, kBenchSize),
+	BootXMemcpy(dst, src + 1, kBenchSize));
+  BENCH("memmove up 8",
+	OldMemcpy(src + 8, src, kBenchSize),
+	BootXMemmove(src + 8, src, kBenchSize));
+  BENCH("memset 0",
+	OldMemset(dst, 0, kBenchSize),
+	BootXMemset(dst, 0, kBenchSize));
+  BENCH("memset 0xAA",
+	OldMemset(dst, 0xAA, kBenchSize),
+	BootXMemset(dst, 0xAA, kBenchSize));
+  memcpy(dst, src, kBenchSize);
+  BENCH("memcmp equal",
+	OldMemcmp(dst, src, kBenchSize),
+	BootXMemcmp(dst, src, kBenchSize));
+  
+#undef BENCH
+  
+  free(src);
+  free(dst);
+}
+
+
+// The functions as they were in mem.c before they moved words.
+
+static void *OldMemcpy(void *dst, const void *src, size_t len)
+{
+  const char *s = src;
+  char       *d = dst;
+  int        pos = 0, dir = 1;
+  
+  if (d > s) {
+    dir = -1;
+    pos = len - 1;
+  }
+  
+  while (len--) {
+    d[pos] = s[pos];
+    pos += dir;
+  }
+  
+  return dst;
+}
+
+
+static void *OldMemset(void *dst, int ch, size_t len)
+{
+  char *d = dst;
+  long tmp = 0x01010101 * (ch & 0x000000FF);
+  
+  if (len < 32) while (len--) *d++ = ch;
+  else {
+    // do the front chunk as chars
+    while ((long)d & 3) {
+      len--;
+      *d++ = ch;
+    }
+    
+    // do the middle chunk as longs
+    while (len > 3) {
+      len -= 4;
+      *(int *)d = tmp;
+      d += 4;
+    }
+    
+    // do the last chunk as chars
+    while (len--) *d++ = ch;
+  }
+  
+  return dst;
+}
+
+
+static int OldMemcmp(const void *b1, const void *b2, size_t len)
+{
+  register long n = len;
+  unsigned char *m1 = (unsigned char *)b1;
+  unsigned char *m2 = (unsigned char *)b2;
+  
+  while (n-- && (*m1 == *m2)) {
+    m1++;
+    m2++;
+  }
+  
+  return ((n < 0) ? 0 : (*m1 - *m2));
+}
+
+
+static long Sign(long value)
+{
+  return (value > 0) - (value < 0);
+}
+
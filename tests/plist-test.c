@@ -0,0 +1,412 @@
+/*
+ * Copyright (c) 2000 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ * 
+ * The contents of this file constitute Original Code as defined in and
+ * are subject to the Apple Public Source License Version 1.1 (the
+ * "License").  You may not use this file except in compliance with the
+ * License.  Please obtain a copy of the License at
+ * http://www.apple.com/publicsource and read it before using this file.
+ * 
+ * This Original Code and all software distributed under the License are
+ * distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON-INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * @APPLE_LICENSE_HEADER_END@
+ */
+/*
+ *  plist-test.c - Times BootX's plist parser on the kexts' Info.plists,
+ *                 or prints the tags it builds or a plist index holds.
+ *
+ *  Copyright (c) 2005 Apple Computer, Inc.
+ *
+ *  DRI: Josh de Cesare
+ */
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "test.h"
+
+// BootX's plist.c is built here as it is.  Build with
+// PLIST_SOURCE='"path/plist.c"' to time another version, and use -n 0
+// to print the tags of each so the two can be compared with diff.
+#ifndef PLIST_SOURCE
+#define PLIST_SOURCE "../bootx.tproj/sl.subproj/plist.c"
+#endif
+#include PLIST_SOURCE
+
+#define ADLER32_USER (1)
+#include "../bootx.tproj/sl.subproj/adler32.c"
+
+// The same size as kDriverTagArenaSize in drivers.c.
+#define kTagArenaSize (0x00400000)
+
+#define kCFBundleType2 (0)
+#define kCFBundleType3 (1)
+
+// As in drivers.c and plist-index.c.
+#define kPListIndexSignature1 'PLIX'
+#define kPListIndexSignature2 'MOSX'
+#define kPListIndexVersion    (1)
+
+#define kPListIndexHeaderSize (8 * 4)
+#define kPListIndexKextSize   (6 * 4)
+#define kPListIndexTagSize    (4 * 4)
+
+struct PList {
+  char *path;
+  char *text;
+  long length;
+};
+typedef struct PList PList;
+
+static long AddPath(char *path);
+static long AddDirectory(char *dirPath, long plugin);
+static long AddPList(char *path);
+static long PrintIndex(char *path);
+static unsigned long GetLong(unsigned char *buffer);
+static long CountTags(TagPtr tag);
+static void PrintTag(TagPtr tag, long depth);
+static int CompareNames(const void *name1, const void *name2);
+
+static PList *gPLists;
+static long  gNumPLists, gPListsSize;
+static char  *gArena;
+
+
+int main(int argc, char **argv)
+{
+  long   cnt, pass, passes, length, tags, failed;
+  char   *buffer;
+  TagPtr dict;
+  double start, seconds;
+  
+  passes = GetPasses(&argc, &argv, 100);
+  if ((passes == -1) || (argc == 0)) {
+    fprintf(stderr, "Usage: %s [-n passes] "
+	    "Extensions-folder|Info.plist ...\n"
+	    "       %s -n 0 Extensions.plistindex\n", gToolName, gToolName);
+    return -1;
+  }
+  
+  // An index from plist-index is printed the same way, so it can be
+  // checked against the Info.plists it was made from.
+  length = strlen(argv[0]);
+  if ((passes == 0) && (argc == 1) && (length >= 11) &&
+      !strcmp(argv[0] + length - 11, ".plistindex")) {
+    return PrintIndex(argv[0]);
+  }
+  
+  for ( ; argc > 0; argv++, argc--) {
+    if (AddPath(*argv) == -1) return -1;
+  }
+  
+  length = 0;
+  for (cnt = 0; cnt < gNumPLists; cnt++) {
+    if (gPLists[cnt].length > length) length = gPLists[cnt].length;
+  }
+  
+  buffer = AllocateTestMemory(length + 1);
+  gArena = AllocateTestMemory(kTagArenaSize);
+  
+  // Check and count what one pass builds, printing the tags if
+  // nothing is to be timed.  The parser writes into the text, so it
+  // is parsed from a copy.
+  InitTagArena(gArena, kTagArenaSize);
+  tags = failed = length = 0;
+  for (cnt = 0; cnt < gNumPLists; cnt++) {
+    memcpy(buffer, gPLists[cnt].text, gPLists[cnt].length + 1);
+    length += gPLists[cnt].length;
+    
+    if (passes == 0) printf("%s\n", gPLists[cnt].path);
+    
+    if ((ParseXML(buffer, &dict) == -1) || (dict == 0)) {
+      fprintf(stderr, "%s: failed to parse %s\n", gToolName,
+	      gPLists[cnt].path);
+      failed++;
+      continue;
+    }
+    
+    tags += CountTags(dict);
+    if (passes == 0) PrintTag(dict, 1);
+  }
+  FreeTagArena();
+  
+  if (passes == 0) return (failed != 0) ? -1 : 0;
+  
+  // Parse everything the way LoadDrivers does, starting each pass
+  // with an empty arena.
+  start = GetSeconds();
+  for (pass = 0; pass < passes; pass++) {
+    InitTagArena(gArena, kTagArenaSize);
+    for (cnt = 0; cnt < gNumPLists; cnt++) {
+      memcpy(buffer, gPLists[cnt].text, gPLists[cnt].length + 1);
+      ParseXML(buffer, &dict);
+    }
+    FreeTagArena();
+  }
+  seconds = GetSeconds() - start;
+  
+  printf("%ld plists, %ld bytes, %ld tags, %ld failed\n"
+	 "%ld passes, %.1f us a pass, %.1f MB/s\n",
+	 gNumPLists, length, tags, failed, passes,
+	 seconds * 1000000.0 / passes,
+	 (double)length * passes / seconds / 1000000.0);
+  
+  return (failed != 0) ? -1 : 0;
+}
+
+
+static long AddPath(char *path)
+{
+  struct stat statBuf;
+  
+  if (stat(path, &statBuf) != 0) {
+    fprintf(stderr, "%s: failed to stat %s\n", gToolName, path);
+    return -1;
+  }
+  
+  if (S_ISDIR(statBuf.st_mode)) return AddDirectory(path, 0);
+  
+  return AddPList(path);
+}
+
+
+// Add the kexts' Info.plists in the order FileLoadDrivers visits them,
+// which is the order of the names in the HFS+ catalog.
+static long AddDirectory(char *dirPath, long plugin)
+{
+  DIR           *dir;
+  struct dirent *entry;
+  struct stat   statBuf;
+  char          **names, kextPath[1024], path[1024 + 32];
+  long          cnt, numNames, length, bundleType;
+  
+  dir = opendir(dirPath);
+  if (dir == NULL) {
+    if (plugin) return 0;
+    fprintf(stderr, "%s: failed to open %s\n", gToolName, dirPath);
+    return -1;
+  }
+  
+  names = 0;
+  numNames = 0;
+  while ((entry = readdir(dir)) != NULL) {
+    length = strlen(entry->d_name);
+    if ((length < 5) || strcmp(entry->d_name + length - 5, ".kext")) continue;
+    
+    names = realloc(names, (numNames + 1) * sizeof(char *));
+    if (names == NULL) {
+      fprintf(stderr, "%s: out of memory\n", gToolName);
+      closedir(dir);
+      return -1;
+    }
+    names[numNames] = AllocateTestMemory(length + 1);
+    strcpy(names[numNames++], entry->d_name);
+  }
+  closedir(dir);
+  
+  qsort(names, numNames, sizeof(char *), CompareNames);
+  
+  for (cnt = 0; cnt < numNames; cnt++) {
+    snprintf(kextPath, sizeof(kextPath), "%s/%s", dirPath, names[cnt]);
+    if ((stat(kextPath, &statBuf) != 0) || !S_ISDIR(statBuf.st_mode)) {
+      continue;
+    }
+    
+    snprintf(path, sizeof(path), "%s/Contents", kextPath);
+    if (stat(path, &statBuf) == 0) bundleType = kCFBundleType2;
+    else bundleType = kCFBundleType3;
+    
+    snprintf(path, sizeof(path), "%s/%sInfo.plist", kextPath,
+	     (bundleType == kCFBundleType2) ? "Contents/" : "");
+    if (stat(path, &statBuf) == 0) {
+      if (AddPList(path) == -1) return -1;
+    }
+    
+    if (!plugin) {
+      snprintf(path, sizeof(path), "%s/%sPlugIns", kextPath,
+	       (bundleType == kCFBundleType2) ? "Contents/" : "");
+      if (AddDirectory(path, 1) == -1) return -1;
+    }
+  }
+  
+  for (cnt = 0; cnt < numNames; cnt++) free(names[cnt]);
+  free(names);
+  
+  return 0;
+}
+
+
+static long AddPList(char *path)
+{
+  PList *plist;
+  
+  if (gNumPLists == gPListsSize) {
+    gPListsSize = (gPListsSize != 0) ? (gPListsSize * 2) : 256;
+    gPLists = realloc(gPLists, gPListsSize * sizeof(PList));
+    if (gPLists == NULL) {
+      fprintf(stderr, "%s: out of memory\n", gToolName);
+      return -1;
+    }
+  }
+  plist = gPLists + gNumPLists;
+  
+  plist->text = (char *)ReadFile(path, &plist->length);
+  if (plist->text == NULL) return -1;
+  
+  plist->path = AllocateTestMemory(strlen(path) + 1);
+  strcpy(plist->path, path);
+  
+  gNumPLists++;
+  
+  return 0;
+}
+
+
+// Check an index the way LoadDriverIndex does, then print each kext's
+// path, bundle ID and OSBundleRequired, and its tags.  The tags are
+// read into host Tags, since the index's are for a 32 bit PowerPC.
+static long PrintIndex(char *path)
+{
+  unsigned char *base, *kext, *buffer;
+  unsigned long numKexts, numTags, tagsStart, tagsEnd, offsets[4];
+  long          cnt, cnt2, length;
+  TagPtr        tags, tag;
+  
+  base = ReadFile(path, &length);
+  if (base == NULL) return -1;
+  
+  if ((length < kPListIndexHeaderSize) ||
+      (GetLong(base + 0) != kPListIndexSignature1) ||
+      (GetLong(base + 4) != kPListIndexSignature2) ||
+      (GetLong(base + 8) != length) ||
+      (GetLong(base + 12) != Adler32(base + 16, length - 16)) ||
+      (GetLong(base + 16) != kPListIndexVersion)) {
+    fprintf(stderr, "%s: %s is not a good index\n", gToolName, path);
+    return -1;
+  }
+  
+  numKexts = GetLong(base + 20);
+  numTags = GetLong(base + 24);
+  tagsStart = kPListIndexHeaderSize + numKexts * kPListIndexKextSize;
+  tagsEnd = tagsStart + numTags * kPListIndexTagSize;
+  if ((numKexts > length) || (numTags > length) || (tagsEnd > length)) {
+    fprintf(stderr, "%s: %s has too many tags\n", gToolName, path);
+    return -1;
+  }
+  
+  tags = AllocateTestMemory(numTags * sizeof(Tag));
+  for (cnt = 0; cnt < numTags; cnt++) {
+    buffer = base + tagsStart + cnt * kPListIndexTagSize;
+    for (cnt2 = 0; cnt2 < 4; cnt2++) offsets[cnt2] = GetLong(buffer + cnt2 * 4);
+    
+    // Links must be to tags, and strings inside the index.
+    for (cnt2 = 2; cnt2 < 4; cnt2++) {
+      if ((offsets[cnt2] != 0) &&
+	  ((offsets[cnt2] < tagsStart) || (offsets[cnt2] >= tagsEnd) ||
+	   ((offsets[cnt2] - tagsStart) % kPListIndexTagSize))) break;
+    }
+    if ((cnt2 != 4) || (offsets[1] >= length)) {
+      fprintf(stderr, "%s: %s: tag %ld is bad\n", gToolName, path, cnt);
+      return -1;
+    }
+    
+    tag = tags + cnt;
+    tag->type = offsets[0];
+    tag->string = (offsets[1] != 0) ? (char *)base + offsets[1] : 0;
+    tag->tag = (offsets[2] != 0) ?
+      tags + (offsets[2] - tagsStart) / kPListIndexTagSize : 0;
+    tag->tagNext = (offsets[3] != 0) ?
+      tags + (offsets[3] - tagsStart) / kPListIndexTagSize : 0;
+  }
+  
+  for (cnt = 0; cnt < numKexts; cnt++) {
+    kext = base + kPListIndexHeaderSize + cnt * kPListIndexKextSize;
+    for (cnt2 = 0; cnt2 < 3; cnt2++) offsets[cnt2] = GetLong(kext + cnt2 * 4);
+    offsets[3] = GetLong(kext + 12);
+    if ((offsets[0] < tagsStart) || (offsets[0] >= tagsEnd) ||
+	(offsets[1] >= length) || (offsets[2] >= length) ||
+	(offsets[3] == 0) || (offsets[3] >= length)) {
+      fprintf(stderr, "%s: %s: kext %ld is bad\n", gToolName, path, cnt);
+      return -1;
+    }
+    
+    printf("%s %s %s\n", base + offsets[3],
+	   (offsets[1] != 0) ? (char *)base + offsets[1] : "-",
+	   (offsets[2] != 0) ? (char *)base + offsets[2] : "-");
+    PrintTag(tags + (offsets[0] - tagsStart) / kPListIndexTagSize, 1);
+  }
+  
+  return 0;
+}
+
+
+static unsigned long GetLong(unsigned char *buffer)
+{
+  return ((unsigned long)buffer[0] << 24) | (buffer[1] << 16) |
+    (buffer[2] << 8) | buffer[3];
+}
+
+
+static long CountTags(TagPtr tag)
+{
+  long count = 0;
+  
+  for ( ; tag != 0; tag = tag->tagNext) {
+    count += 1 + CountTags(tag->tag);
+    
+    // A reference repeated back to back links a tag to itself.
+    if (tag->tagNext == tag) break;
+  }
+  
+  return count;
+}
+
+
+// Print a tag and the tags below it, one to a line.
+static void PrintTag(TagPtr tag, long depth)
+{
+  static char *typeNames[] = {
+    "none", "dict", "key", "string", "integer",
+    "data", "date", "false", "true", "array"
+  };
+  
+  for ( ; tag != 0; tag = tag->tagNext) {
+    printf("%*s%s", (int)depth * 2, "",
+	   ((tag->type >= kTagTypeNone) && (tag->type <= kTagTypeArray)) ?
+	   typeNames[tag->type] : "?");
+    if (tag->string != 0) printf(" \"%s\"", tag->string);
+    printf("\n");
+    
+    PrintTag(tag->tag, depth + 1);
+    
+    if (tag->tagNext == tag) break;
+  }
+}
+
+
+// HFS+ keeps names in order without regard to case.  UTF-8 sorts
+// as UTF-16 does outside of the surrogates, which kext names do not
+// use, so only the ASCII letters need folding.
+static int CompareNames(const void *name1, const void *name2)
+{
+  const unsigned char *str1 = *(unsigned char **)name1;
+  const unsigned char *str2 = *(unsigned char **)name2;
+  int                 ch1, ch2;
+  
+  do {
+    ch1 = *str1++;
+    ch2 = *str2++;
+    if ((ch1 >= 'A') && (ch1 <= 'Z')) ch1 += 'a' - 'A';
+    if ((ch2 >= 'A') && (ch2 <= 'Z')) ch2 += 'a' - 'A';
+  } while ((ch1 == ch2) && (ch1 != '\0'));
+  
+  return ch1 - ch2;
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2000 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ * 
+ * The contents of this file constitute Original Code as defined in and
+ * are subject to the Apple Public Source License Version 1.1 (the
+ * "License").  You may not use this file except in compliance with the
+ * License.  Please obtain a copy of the License at
+ * http://www.apple.com/publicsource and read it before using this file.
+ * 
+ * This Original Code and all software distributed under the License are
+ * distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON-INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * @APPLE_LICENSE_HEADER_END@
+ */
+/*
+ *  test.c - Functions shared by BootX's host tests.
+ *
+ *  Copyright (c) 2005 Apple Computer, Inc.
+ *
+ *  DRI: Josh de Cesare
+ */
+
+#include <sys/time.h>
+
+#include "test.h"
+
+char *gToolName;
+
+
+// Take "-n passes" off the front of the arguments, returning -1 for
+// any other option.  With 0 passes a test only checks, and times
+// nothing.
+long GetPasses(int *argc, char ***argv, long passes)
+{
+  gToolName = **argv;
+  
+  for ((*argv)++, (*argc)--; (*argc > 0) && (***argv == '-');
+       (*argv)++, (*argc)--) {
+    if (strcmp(**argv, "-n") || (*argc < 2)) return -1;
+    passes = atol(*++(*argv));
+    (*argc)--;
+    if (passes < 0) return -1;
+  }
+  
+  return passes;
+}
+
+
+void *AllocateTestMemory(long size)
+{
+  void *addr;
+  
+  addr = malloc(size);
+  if (addr == NULL) {
+    fprintf(stderr, "%s: out of memory\n", gToolName);
+    exit(-1);
+  }
+  
+  return addr;
+}
+
+
+// Read a whole file, with a NUL after it.
+unsigned char *ReadFile(char *fileName, long *length)
+{
+  FILE          *file;
+  unsigned char *buffer;
+  
+  file = fopen(fileName, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "%s: failed to open %s\n", gToolName, fileName);
+    return NULL;
+  }
+  fseek(file, 0, SEEK_END);
+  *length = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  
+  buffer = AllocateTestMemory(*length + 1);
+  if (fread(buffer, 1, *length, file) != *length) {
+    fprintf(stderr, "%s: failed to read %s\n", gToolName, fileName);
+    fclose(file);
+    free(buffer);
+    return NULL;
+  }
+  fclose(file);
+  buffer[*length] = '\0';
+  
+  return buffer;
+}
+
+
+double GetSeconds(void)
+{
+  struct timeval time;
+  
+  gettimeofday(&time, NULL);
+  
+  return time.tv_sec + time.tv_usec / 1000000.0;
+}
+
+
+// What BootX's files get from AllocateBootXMemory is never freed.
+void *AllocateBootXMemory(long size)
+{
+  return calloc(1, size);
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2000 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ * 
+ * The contents of this file constitute Original Code as defined in and
+ * are subject to the Apple Public Source License Version 1.1 (the
+ * "License").  You may not use this file except in compliance with the
+ * License.  Please obtain a copy of the License at
+ * http://www.apple.com/publicsource and read it before using this file.
+ * 
+ * This Original Code and all software distributed under the License are
+ * distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON-INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * @APPLE_LICENSE_HEADER_END@
+ */
+/*
+ *  test.h - Definitions shared by BootX's host tests.
+ *
+ *  Copyright (c) 2005 Apple Computer, Inc.
+ *
+ *  DRI: Josh de Cesare
+ */
+
+#ifndef _BOOTX_TEST_H_
+#define _BOOTX_TEST_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+// The tests build BootX's .c files as they are.  sl.h is kept out,
+// since libclite.h does not agree with the host's headers, and what
+// the files need from it is defined here the same way.
+#define _BOOTX_SL_H_
+
+typedef enum {
+  kTagTypeNone = 0,
+  kTagTypeDict,
+  kTagTypeKey,
+  kTagTypeString,
+  kTagTypeInteger,
+  kTagTypeData,
+  kTagTypeDate,
+  kTagTypeFalse,
+  kTagTypeTrue,
+  kTagTypeArray
+} TagType;
+
+struct Tag {
+  TagType     type;
+  char       *string;
+  struct Tag *tag;
+  struct Tag *tagNext;
+};
+typedef struct Tag Tag, *TagPtr;
+
+struct lzss_stream {
+  u_int8_t  *dststart;
+  u_int8_t  *dst;
+  int       checksum;
+  u_int32_t adler32;
+};
+typedef struct lzss_stream lzss_stream;
+
+extern void *AllocateBootXMemory(long size);
+
+// Externs for adler32.c
+extern void InitAdler32(void);
+extern unsigned long Adler32(unsigned char *buffer, long length);
+extern unsigned long UpdateAdler32(unsigned long adler,
+				   unsigned char *buffer, long length);
+
+// Externs for lzss.c
+extern int decompress_lzss(u_int8_t *dst, u_int8_t *src, u_int32_t srclen);
+extern int decompress_lzss_adler32(u_int8_t *dst, u_int8_t *src,
+				   u_int32_t srclen, u_int32_t *adler32);
+extern void decompress_lzss_start(lzss_stream *stream, u_int8_t *dst,
+				  int checksum);
+extern u_int32_t decompress_lzss_chunk(lzss_stream *stream, u_int8_t *src,
+				       u_int32_t srclen, int last);
+
+// Externs for plist.c
+#define PLIST_DEBUG 0
+
+extern TagPtr GetProperty(TagPtr dict, char *key);
+extern long ParseXML(char *buffer, TagPtr *dict);
+extern void FreeTag(TagPtr tag);
+extern void InitTagArena(char *addr, long size);
+extern void FreeTagArena(void);
+extern TagPtr KeepTag(TagPtr tag);
+
+// Externs for test.c
+extern char *gToolName;
+
+extern long GetPasses(int *argc, char ***argv, long passes);
+extern void *AllocateTestMemory(long size);
+extern unsigned char *ReadFile(char *fileName, long *length);
+extern double GetSeconds(void);
+
+#endif /* ! _BOOTX_TEST_H_ */
@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2000 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ * 
+ * The contents of this file constitute Original Code as defined in and
+ * are subject to the Apple Public Source License Version 1.1 (the
+ * "License").  You may not use this file except in compliance with the
+ * License.  Please obtain a copy of the License at
+ * http://www.apple.com/publicsource and read it before using this file.
+ * 
+ * This Original Code and all software distributed under the License are
+ * distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE OR NON-INFRINGEMENT.  Please see the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * @APPLE_LICENSE_HEADER_END@
+ */
+/*
+ *  timeline-trace.c - Turns BootX's BootXTimeline property into a
+ *                     trace in the Chrome trace event format.
+ *
+ *  Copyright (c) 2005 Apple Computer, Inc.
+ *
+ *  DRI: Josh de Cesare
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+// The property is written by SaveTimeline in BootX's timeline.c, and
+// the definitions here must match the ones there.  It is big endian.
+#define kTimelineSignature (0x4258544C)
+#define kTimelineVersion   (1)
+
+#define kTimelineHeaderSize (6 * 4)
+#define kTimelineEventSize  (4 * 4)
+
+static unsigned char *ReadProperty(char *fileName, long *length);
+static long HexDigit(int c);
+static void WriteEvent(FILE *file, unsigned char *names, long name,
+		       long type, double time, long arg);
+static void WriteString(FILE *file, unsigned char *string);
+static unsigned long GetLong(unsigned char *buffer);
+static unsigned long GetShort(unsigned char *buffer);
+
+char *gToolName;
+
+static long gNumWritten;
+
+
+int main(int argc, char **argv)
+{
+  FILE          *file;
+  unsigned char *prop, *events, *event, *names;
+  unsigned long long start, time;
+  double        tbFrequency, usecs = 0;
+  long          length, numEvents, namesLength, dropped, cnt;
+  long          name, type, depth, *open;
+  
+  gToolName = *argv;
+  
+  if ((argc != 2) && (argc != 3)) {
+    fprintf(stderr, "Usage: %s property-file [trace-file]\n", gToolName);
+    return -1;
+  }
+  
+  prop = ReadProperty(argv[1], &length);
+  if (prop == NULL) return -1;
+  
+  if ((length < kTimelineHeaderSize) ||
+      (GetLong(prop) != kTimelineSignature) ||
+      (GetLong(prop + 4) != kTimelineVersion)) {
+    fprintf(stderr, "%s: %s is not a BootXTimeline property\n",
+	    gToolName, argv[1]);
+    return -1;
+  }
+  
+  tbFrequency = GetLong(prop + 8);
+  numEvents = GetLong(prop + 12);
+  namesLength = GetLong(prop + 16);
+  dropped = GetLong(prop + 20);
+  
+  if ((numEvents > length) || (namesLength > length) ||
+      ((kTimelineHeaderSize + numEvents * kTimelineEventSize +
+	namesLength) != length) ||
+      ((namesLength != 0) && (prop[length - 1] != '\0'))) {
+    fprintf(stderr, "%s: %s is cut short\n", gToolName, argv[1]);
+    return -1;
+  }
+  
+  events = prop + kTimelineHeaderSize;
+  names = events + numEvents * kTimelineEventSize;
+  
+  if (tbFrequency == 0) {
+    fprintf(stderr, "%s: no timebase frequency; times are in ticks\n",
+	    gToolName);
+    tbFrequency = 1000000;
+  }
+  if (dropped != 0) {
+    fprintf(stderr, "%s: %ld events were dropped\n", gToolName, dropped);
+  }
+  
+  if (argc == 3) {
+    file = fopen(argv[2], "w");
+    if (file == NULL) {
+      fprintf(stderr, "%s: failed to open %s\n", gToolName, argv[2]);
+      return -1;
+    }
+  } else file = stdout;
+  
+  // Phases still open at the end were cut off by SaveTimeline.
+  open = malloc((numEvents + 1) * sizeof(long));
+  if (open == NULL) {
+    fprintf(stderr, "%s: out of memory\n", gToolName);
+    return -1;
+  }
+  depth = 0;
+  
+  fprintf(file, "{\"traceEvents\":[\n");
+  
+  start = 0;
+  for (cnt = 0; cnt < numEvents; cnt++) {
+    event = events + cnt * kTimelineEventSize;
+    time = ((unsigned long long)GetLong(event) << 32) | GetLong(event + 4);
+    name = GetShort(event + 8);
+    type = GetShort(event + 10);
+    if (name >= namesLength) {
+      fprintf(stderr, "%s: event %ld has a bad name\n", gToolName, cnt);
+      continue;
+    }
+    
+    if (cnt == 0) start = time;
+    usecs = (double)(time - start) * 1000000.0 / tbFrequency;
+    
+    if (type == 'B') open[depth++] = name;
+    else if ((type == 'E') && (depth > 0)) depth--;
+    
+    WriteEvent(file, names, name, type, usecs, (int)GetLong(event + 12));
+  }
+  
+  while (depth > 0) {
+    WriteEvent(file, names, open[--depth], 'E', usecs, 0);
+  }
+  
+  fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+  
+  if (file != stdout) fclose(file);
+  
+  free(open);
+  free(prop);
+  
+  return 0;
+}
+
+
+// The property can be raw, or in hex between < and > as ioreg prints
+// it, e.g. from "ioreg -p IODeviceTree -n chosen".
+static unsigned char *ReadProperty(char *fileName, long *length)
+{
+  FILE          *file;
+  unsigned char *buffer, *text;
+  long          size, cnt, high, low;
+  
+  file = fopen(fileName, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "%s: failed to open %s\n", gToolName, fileName);
+    return NULL;
+  }
+  fseek(file, 0, SEEK_END);
+  size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  
+  buffer = malloc(size + 1);
+  if ((buffer == NULL) || (fread(buffer, 1, size, file) != size)) {
+    fprintf(stderr, "%s: failed to read %s\n", gToolName, fileName);
+    fclose(file);
+    return NULL;
+  }
+  fclose(file);
+  buffer[size] = '\0';
+  
+  if ((size >= 4) && (GetLong(buffer) == kTimelineSignature)) {
+    *length = size;
+    return buffer;
+  }
+  
+  // Find the data, after the property's name if it is there.
+  text = (unsigned char *)strstr((char *)buffer, "\"BootXTimeline\"");
+  if (text == NULL) text = buffer;
+  text = (unsigned char *)strchr((char *)text, '<');
+  if (text == NULL) {
+    fprintf(stderr, "%s: no property data in %s\n", gToolName, fileName);
+    return NULL;
+  }
+  
+  // The bytes are put back into the same buffer.
+  cnt = 0;
+  text++;
+  while (1) {
+    while (isspace(*text)) text++;
+    if (*text == '>') break;
+    high = HexDigit(text[0]);
+    low = (high != -1) ? HexDigit(text[1]) : -1;
+    if (low == -1) {
+      fprintf(stderr, "%s: bad property data in %s\n", gToolName, fileName);
+      return NULL;
+    }
+    buffer[cnt++] = (high << 4) | low;
+    text += 2;
+  }
+  
+  *length = cnt;
+  return buffer;
+}
+
+
+static long HexDigit(int c)
+{
+  if ((c >= '0') && (c <= '9')) return c - '0';
+  if ((c >= 'a') && (c <= 'f')) return c - 'a' + 10;
+  if ((c >= 'A') && (c <= 'F')) return c - 'A' + 10;
+  return -1;
+}
+
+
+static void WriteEvent(FILE *file, unsigned char *names, long name,
+		       long type, double time, long arg)
+{
+  if (gNumWritten++ != 0) fprintf(file, ",\n");
+  
+  fprintf(file, "{\"name\":");
+  WriteString(file, names + name);
+  fprintf(file, ",\"cat\":\"BootX\",\"ph\":\"%c\",\"ts\":%.3f,"
+	  "\"pid\":1,\"tid\":1", (type == 'I') ? 'i' : (int)type, time);
+  if (type == 'I') fprintf(file, ",\"s\":\"g\"");
+  fprintf(file, ",\"args\":{\"arg\":%ld}}", arg);
+}
+
+
+static void WriteString(FILE *file, unsigned char *string)
+{
+  fputc('"', file);
+  for ( ; *string != '\0'; string++) {
+    if ((*string == '"') || (*string == '\\')) fprintf(file, "\\%c", *string);
+    else if (*string < 0x20) fprintf(file, "\\u%04x", *string);
+    else fputc(*string, file);
+  }
+  fputc('"', file);
+}
+
+
+static unsigned long GetLong(unsigned char *buffer)
+{
+  return ((unsigned long)buffer[0] << 24) | (buffer[1] << 16) |
+    (buffer[2] << 8) | buffer[3];
+}
+
+
+static unsigned long GetShort(unsigned char *buffer)
+{
+  return (buffer[0] << 8) | buffer[1];
+}